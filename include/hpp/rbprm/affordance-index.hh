@@ -0,0 +1,111 @@
+//
+// Copyright (c) 2014 CNRS
+// Authors: Steve Tonneau
+//
+// This file is part of hpp-rbprm
+// hpp-rbprm is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-core is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-core  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef HPP_RBPRM_AFFORDANCE_INDEX_HH
+# define HPP_RBPRM_AFFORDANCE_INDEX_HH
+
+# include <hpp/rbprm/config.hh>
+# include <hpp/rbprm/sampling/sample-db.hh>
+# include <hpp/model/collision-object.hh>
+# include <hpp/fcl/BV/AABB.h>
+
+# include <map>
+# include <vector>
+
+namespace hpp {
+  namespace rbprm {
+
+    HPP_PREDEF_CLASS(AffordanceIndex);
+    typedef boost::shared_ptr <AffordanceIndex> AffordanceIndexPtr_t;
+    typedef std::map<std::string, std::vector<model::CollisionObjectPtr_t> > affMap_t;
+
+    /// Broad phase over the affordance objects of a scene.
+    /// Stores the world AABB of each object in a static AABB tree, built once,
+    /// so that the objects close to a limb can be found without testing all of them.
+    /// The triangle normals of the objects are computed with the index.
+    /// Affordance objects are assumed not to move after the index is built.
+    /// Queries are read only and can be run concurrently.
+    class HPP_RBPRM_DLLAPI AffordanceIndex
+    {
+    public:
+        /// \param affordances affordance objects of the scene, by affordance type
+        static AffordanceIndexPtr_t create (const affMap_t& affordances);
+
+    public:
+        /// Returns the objects whose AABB overlaps a box. Objects are returned in the
+        /// order of the affordance map, whatever the tree structure.
+        /// \param box world axis aligned bounding box
+        /// \param affordanceTypes only returns objects of these types. If empty, objects of all types are returned
+        /// \return the objects overlapping the box
+        model::ObjectVector_t query (const fcl::AABB& box,
+                                     const std::vector<std::string>& affordanceTypes = std::vector<std::string>()) const;
+
+        /// \return true if the index was built from these affordances
+        bool indexes (const affMap_t& affordances) const;
+
+        /// \return true if object is one of the indexed affordance objects
+        bool contains (const model::CollisionObjectPtr_t& object) const;
+
+        std::size_t size () const {return entries_.size();}
+
+        /// triangle normals of the indexed objects, see sampling::AddAffordanceNormals
+        const sampling::AffordanceNormalsPtr_t& normals () const {return normals_;}
+
+        /// world AABB of a geometry placed at a given transformation
+        static fcl::AABB worldAABB (const fcl::CollisionGeometry& geometry, const fcl::Transform3f& transform);
+        /// world AABB of a collision object at its current position
+        static fcl::AABB worldAABB (const model::CollisionObjectPtr_t& object);
+
+    private:
+        struct Entry
+        {
+            model::CollisionObjectPtr_t object_;
+            std::size_t type_;
+            fcl::AABB box_;
+        };
+
+        /// leaves contain the entries [first_, first_ + count_[ of order_,
+        /// inner nodes have count_ = 0
+        struct Node
+        {
+            fcl::AABB box_;
+            std::size_t left_;
+            std::size_t right_;
+            std::size_t first_;
+            std::size_t count_;
+        };
+
+        AffordanceIndex (const affMap_t& affordances);
+        /// builds the subtree of the entries [first, first + count[ of order_
+        /// \param boxes boxes of the entries
+        /// \return index of the subtree root
+        std::size_t build (const std::vector<fcl::AABB>& boxes, const std::size_t first, const std::size_t count);
+
+    private:
+        std::vector<std::string> types_;
+        std::vector<Entry> entries_;
+        std::vector<std::size_t> order_;
+        std::vector<Node> nodes_;
+        /// indexed objects, sorted by address
+        model::ObjectVector_t sortedObjects_;
+        sampling::AffordanceNormalsPtr_t normals_;
+    }; // class AffordanceIndex
+  } // namespace rbprm
+} // namespace hpp
+
+#endif // HPP_RBPRM_AFFORDANCE_INDEX_HH
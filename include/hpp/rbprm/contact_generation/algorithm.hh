@@ -21,6 +21,7 @@
 
 # include <hpp/rbprm/reports.hh>
 # include <hpp/rbprm/contact_generation/contact_generation.hh>
+# include <hpp/rbprm/kinematics-workspace.hh>
 
 # include <queue>
 
@@ -77,6 +78,31 @@ hpp::rbprm::contact::ContactReport HPP_RBPRM_DLLAPI ComputeContacts(
         const std::map<std::string, std::vector<std::string> >& affFilters, const fcl::Vec3f& direction,
   const double robustnessTreshold = 0,const fcl::Vec3f& acceleration = fcl::Vec3f(0,0,0));
 
+/// Same as ComputeContacts, computed on the robot of a workspace instead of the shared robot.
+/// The shared robot the workspace was created from is not modified, so that several threads,
+/// each with its own workspace, can generate contacts for the same robot.
+/// The configuration is loaded with KinematicsWorkspace::configuration, so the forward
+/// kinematics are not computed again when the workspace is still in configuration.
+/// The device of the workspace is not restored afterwards.
+///
+/// \param workspace workspace of the calling thread
+hpp::rbprm::State HPP_RBPRM_DLLAPI ComputeContacts(
+  KinematicsWorkspace& workspace, model::ConfigurationIn_t configuration,
+  const affMap_t& affordances,
+  const std::map<std::string, std::vector<std::string> >& affFilters, const fcl::Vec3f& direction,
+  const double robustnessTreshold = 0, const fcl::Vec3f& acceleration = fcl::Vec3f(0,0,0));
+
+/// Same as ComputeContacts, computed on the robot of a workspace instead of the shared robot.
+/// The shared robot the workspace was created from is not modified.
+///
+/// \param workspace workspace of the calling thread
+hpp::rbprm::contact::ContactReport HPP_RBPRM_DLLAPI ComputeContacts(
+        const hpp::rbprm::State& previous, KinematicsWorkspace& workspace,
+        model::ConfigurationIn_t configuration,
+            const affMap_t& affordances,
+        const std::map<std::string, std::vector<std::string> >& affFilters, const fcl::Vec3f& direction,
+  const double robustnessTreshold = 0,const fcl::Vec3f& acceleration = fcl::Vec3f(0,0,0));
+
 
     } // namespace contact
   } // namespace rbprm
@@ -64,6 +64,30 @@ struct ContactGenHelper
     hpp::rbprm::State workingState_;
     bool checkStabilityGenerate_;
     Q_State candidates_;
+    /// maximum number of contact candidates kept for each contact generation, 0 for no limit
+    std::size_t maxCandidates_;
+    /// broad phase over affordances_, null if not available
+    AffordanceIndexPtr_t affordanceIndex_;
+    /// triangle normals of affordances_, computed before contact generation and then only read.
+    /// Null if not available, the normals are then computed by each request
+    sampling::AffordanceNormalsPtr_t affordanceNormals_;
+    /// maximum number of samples requested to each affordance, 0 for no limit.
+    /// Also bounds the candidates kept if maxCandidates_ is 0
+    std::size_t sampleBudget_;
+    /// level of the octree voxels used to spread the sample budget over the colliding areas
+    std::size_t coarseLevel_;
+    /// largest angle between the effector normal of a sample and the normal of the contacted
+    /// triangle for the sample to be considered, for limbs with an orientation index.
+    /// M_PI, the default, disables the filter
+    double maxOrientationAngle_;
+    /// number of contact candidates projected in parallel, each on a worker of fullBody_
+    /// (see RbPrmFullBody::workers). The candidates are still selected in the order of the
+    /// heuristic. 0 or 1 to project the candidates one at a time on fullBody_
+    std::size_t speculativeCandidates_;
+    /// number of workers exploring the candidate states of maintain_contacts and gen_contacts
+    /// in parallel (see RbPrmFullBody::workers). The first state that succeeds in the order
+    /// of the queues is selected. 0 or 1 to explore the states one at a time on fullBody_
+    std::size_t combinatorialWorkers_;
 };
 
 
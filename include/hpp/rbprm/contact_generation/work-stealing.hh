@@ -0,0 +1,108 @@
+/// Copyright (c) 2017 CNRS
+/// Authors: stonneau
+///
+///
+// This file is part of hpp-rbprm.
+// hpp-rbprm is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-wholebody-step-planner is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Lesser Public License for more details. You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-wholebody-step-planner. If not, see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef HPP_RBPRM_WORK_STEALING_HH
+# define HPP_RBPRM_WORK_STEALING_HH
+
+# include <deque>
+# include <vector>
+# include <omp.h>
+
+namespace hpp {
+namespace rbprm {
+namespace contact{
+
+/// Finds the first task, in priority order, that succeeds, by running the tasks on
+/// several workers. Task i has a higher priority than task j if i < j.
+/// Worker w starts with the tasks w, w + nbWorkers, w + 2 nbWorkers... which it runs
+/// by decreasing priority. A worker with no task left steals the lowest priority task
+/// of another worker. Once a task succeeds, the tasks with a lower priority are not
+/// started anymore. The tasks with a higher priority are all run, so the result does
+/// not depend on the scheduling.
+/// \param task functor with a method bool operator()(const std::size_t task, const std::size_t worker),
+/// returning whether the task succeeds. Tasks run by the same worker are run sequentially.
+/// \param nbTasks number of tasks
+/// \param nbWorkers number of workers
+/// \return the index of the first task that succeeds, nbTasks if none does
+template<typename Task>
+std::size_t findFirstSuccess(Task& task, const std::size_t nbTasks, const std::size_t nbWorkers)
+{
+    if(nbTasks == 0 || nbWorkers == 0)
+        return nbTasks;
+    std::vector<std::deque<std::size_t> > queues(nbWorkers);
+    for(std::size_t i = 0; i < nbTasks; ++i)
+        queues[i % nbWorkers].push_back(i);
+    std::vector<omp_lock_t> locks(nbWorkers);
+    for(std::size_t w = 0; w < nbWorkers; ++w)
+        omp_init_lock(&locks[w]);
+    std::size_t firstSuccess = nbTasks;
+    #pragma omp parallel num_threads((int)nbWorkers)
+    {
+        // a smaller team than requested shares the queues of the missing workers
+        const std::size_t worker = (std::size_t)omp_get_thread_num();
+        for(;;)
+        {
+            std::size_t current = nbTasks;
+            for(std::size_t k = 0; k < nbWorkers && current == nbTasks; ++k)
+            {
+                // own queue first, from the front, then the others, from the back
+                const std::size_t victim = (worker + k) % nbWorkers;
+                omp_set_lock(&locks[victim]);
+                if(!queues[victim].empty())
+                {
+                    if(k == 0)
+                    {
+                        current = queues[victim].front();
+                        queues[victim].pop_front();
+                    }
+                    else
+                    {
+                        current = queues[victim].back();
+                        queues[victim].pop_back();
+                    }
+                }
+                omp_unset_lock(&locks[victim]);
+            }
+            if(current == nbTasks)
+                break;
+            std::size_t bound;
+            #pragma omp critical (workStealingSuccess)
+            {
+                bound = firstSuccess;
+            }
+            if(current > bound)
+                continue;
+            if(task(current, worker))
+            {
+                #pragma omp critical (workStealingSuccess)
+                {
+                    if(current < firstSuccess)
+                        firstSuccess = current;
+                }
+            }
+        }
+    }
+    for(std::size_t w = 0; w < nbWorkers; ++w)
+        omp_destroy_lock(&locks[w]);
+    return firstSuccess;
+}
+
+} // namespace contact
+} // namespace rbprm
+} // namespace hpp
+#endif // HPP_RBPRM_WORK_STEALING_HH
@@ -0,0 +1,109 @@
+//
+// Copyright (c) 2014 CNRS
+// Authors: Steve Tonneau (steve.tonneau@laas.fr)
+//
+// This file is part of hpp-rbprm.
+// hpp-rbprm is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-rbprm is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-core  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef HPP_RBPRM_CONTACT_CACHE_HH
+# define HPP_RBPRM_CONTACT_CACHE_HH
+
+# include <hpp/rbprm/config.hh>
+# include <hpp/rbprm/rbprm-fullbody.hh>
+# include <hpp/rbprm/reports.hh>
+
+# include <map>
+# include <vector>
+
+namespace hpp {
+  namespace rbprm {
+  namespace interpolation {
+    HPP_PREDEF_CLASS(ContactCache);
+    typedef boost::shared_ptr <ContactCache> ContactCachePtr_t;
+
+    /// Memoization of contact::ComputeContacts for the discretized configurations of a path.
+    /// Reports are stored by previous contact state and by root pose, quantized with the
+    /// resolutions of the cache. The contacts of the previous state are compared exactly,
+    /// so that a contact maintained by a cached report is not moved.
+    /// A cached report is only reused after its contacts are projected on the requested
+    /// root pose, and if the projection is collision free and as stable as the cached state.
+    /// The cache assumes the affordances of the requests do not change.
+    class HPP_RBPRM_DLLAPI ContactCache
+    {
+    public:
+        /// \param fullBody robot on which cached reports are projected
+        /// \param positionResolution size of the cells of the root positions, in meters
+        /// \param orientationResolution size of the cells of the components of the root quaternion
+        /// \param maxSize number of reports after which the cache is emptied
+        static ContactCachePtr_t create (const RbPrmFullBodyPtr_t& fullBody, const double positionResolution = 0.01,
+                                         const double orientationResolution = 0.01, const std::size_t maxSize = 10000);
+
+    public:
+        /// Retrieves the report computed for a nearby request, projected on configuration.
+        /// \param previous previous state of the request
+        /// \param configuration requested configuration
+        /// \param robustnessTreshold robustness required for a stable state
+        /// \param acceleration acceleration of the request
+        /// \param report the projected report, if found
+        /// \return true if a cached report could be reused
+        bool get (const State& previous, model::ConfigurationIn_t configuration, const double robustnessTreshold,
+                  const fcl::Vec3f& acceleration, contact::ContactReport& report);
+
+        /// Stores the report computed for a request
+        void insert (const State& previous, model::ConfigurationIn_t configuration, const double robustnessTreshold,
+                     const contact::ContactReport& report);
+
+        /// \return the report stored for a request, as computed, or 0
+        const contact::ContactReport* find (const State& previous, model::ConfigurationIn_t configuration,
+                                            const double robustnessTreshold) const;
+
+        void clear ();
+        std::size_t size () const {return reports_.size();}
+        /// number of requests answered by get with a cached report
+        std::size_t hits () const {return hits_;}
+        /// number of requests get could not answer, because no report was cached or it could not be reused
+        std::size_t misses () const {return misses_;}
+
+    public:
+        const double positionResolution_;
+        const double orientationResolution_;
+        const std::size_t maxSize_;
+
+    private:
+        ContactCache (const RbPrmFullBodyPtr_t& fullBody, const double positionResolution,
+                      const double orientationResolution, const std::size_t maxSize);
+
+        struct Key
+        {
+            /// contact order of the previous state
+            std::vector<std::string> contacts_;
+            /// positions of the previous contacts, in contacts_ order, and robustness
+            std::vector<double> values_;
+            /// quantized root position and orientation
+            std::vector<long> cells_;
+            bool operator< (const Key& other) const;
+        };
+        Key key (const State& previous, model::ConfigurationIn_t configuration, const double robustnessTreshold) const;
+
+    private:
+        const RbPrmFullBodyPtr_t fullBody_;
+        std::map<Key, contact::ContactReport> reports_;
+        std::size_t hits_;
+        std::size_t misses_;
+    }; // class ContactCache
+  } // namespace interpolation
+  } // namespace rbprm
+} // namespace hpp
+
+#endif // HPP_RBPRM_CONTACT_CACHE_HH
@@ -21,6 +21,7 @@
 
 # include <hpp/rbprm/config.hh>
 # include <hpp/rbprm/rbprm-fullbody.hh>
+# include <hpp/rbprm/interpolation/contact-cache.hh>
 # include <hpp/core/path-vector.hh>
 # include <hpp/model/device.hh>
 
@@ -86,6 +87,11 @@ namespace hpp {
 
         core::Configuration_t configPosition(core::ConfigurationIn_t previous, const core::PathVectorConstPtr_t path, double i);
 
+        /// Optional cache of the contact states computed by Interpolate, see ContactCache.
+        /// Useful for small time steps, for which consecutive configurations often
+        /// lead to the same contacts. Null by default.
+        void contactCache(const ContactCachePtr_t& cache) {contactCache_ = cache;}
+        const ContactCachePtr_t& contactCache() const {return contactCache_;}
 
     public:
         const core::PathVectorConstPtr_t path_;
@@ -94,6 +100,7 @@ namespace hpp {
 
     private:
         RbPrmFullBodyPtr_t robot_;
+        ContactCachePtr_t contactCache_;
 
     protected:
       RbPrmInterpolation (const core::PathVectorConstPtr_t path, const RbPrmFullBodyPtr_t robot,const State& start, const State& end);
@@ -0,0 +1,63 @@
+//
+// Copyright (c) 2014 CNRS
+// Authors: Steve Tonneau
+//
+// This file is part of hpp-rbprm
+// hpp-rbprm is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-core is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-core  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef HPP_RBPRM_KINEMATICS_WORKSPACE_HH
+# define HPP_RBPRM_KINEMATICS_WORKSPACE_HH
+
+# include <hpp/rbprm/config.hh>
+# include <hpp/rbprm/rbprm-fullbody.hh>
+
+namespace hpp {
+  namespace rbprm {
+
+    HPP_PREDEF_CLASS(KinematicsWorkspace);
+    typedef boost::shared_ptr <KinematicsWorkspace> KinematicsWorkspacePtr_t;
+
+    /// Kinematic state of a RbPrmFullBody for one configuration, computed on a private copy
+    /// of its device. The copy shares the limb databases of the robot, but has its own
+    /// limbs and collision validations.
+    /// Contact generation run on fullBody() only modifies the workspace, so that several
+    /// threads, each with its own workspace, can share the same RbPrmFullBody.
+    /// A workspace must not be used by several threads at the same time.
+    class HPP_RBPRM_DLLAPI KinematicsWorkspace
+    {
+    public:
+        /// \param fullBody shared robot, only read
+        static KinematicsWorkspacePtr_t create (const RbPrmFullBody& fullBody);
+
+    public:
+        /// Sets the configuration of the workspace and computes the forward kinematics.
+        /// Nothing is computed if the workspace is already in this configuration.
+        void configuration (model::ConfigurationIn_t configuration);
+        const model::Configuration_t& configuration () const {return configuration_;}
+
+        /// copy of the shared robot on which the contacts of the workspace are generated.
+        /// Its device is not guaranteed to remain in configuration()
+        const RbPrmFullBodyPtr_t& fullBody () const {return fullBody_;}
+
+    private:
+        KinematicsWorkspace (const RbPrmFullBody& fullBody);
+
+    private:
+        const RbPrmFullBodyPtr_t fullBody_;
+        model::Configuration_t configuration_;
+    }; // class KinematicsWorkspace
+  } // namespace rbprm
+} // namespace hpp
+
+#endif // HPP_RBPRM_KINEMATICS_WORKSPACE_HH
@@ -0,0 +1,78 @@
+//
+// Copyright (c) 2014 CNRS
+// Authors: Steve Tonneau (steve.tonneau@laas.fr)
+//
+// This file is part of hpp-rbprm.
+// hpp-rbprm is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-rbprm is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-core  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef HPP_RBPRM_RANDOM_HH
+# define HPP_RBPRM_RANDOM_HH
+
+# include <hpp/rbprm/config.hh>
+# include <boost/cstdint.hpp>
+# include <cstddef>
+
+namespace hpp {
+  namespace rbprm {
+    /// xoshiro256** pseudo random generator.
+    /// It has no constructor, so that it can be stored per thread:
+    /// seed must be called before drawing values.
+    class HPP_RBPRM_DLLAPI RandomGenerator
+    {
+    public:
+        /// Initializes the state. Generators with the same seed and different
+        /// streams produce independent sequences.
+        void seed(const boost::uint64_t seed, const boost::uint64_t stream = 0);
+
+        /// \return the next 64 bits random value
+        boost::uint64_t next();
+
+        /// \return a value uniformly distributed in [0, 1[
+        double uniform();
+
+        /// \return a value uniformly distributed in [min, max[
+        double uniform(const double min, const double max);
+
+        /// \return an integer uniformly distributed in [0, n[. n must be positive
+        std::size_t index(const std::size_t n);
+
+        /// same as index, to be used with std::random_shuffle
+        std::ptrdiff_t operator()(const std::ptrdiff_t n);
+
+    private:
+        boost::uint64_t state_[4];
+    }; // class RandomGenerator
+
+    /// Sets the seed of the random generators of all the threads.
+    /// A thread draws from the stream given by its OpenMP thread numbers in the enclosing
+    /// teams the first time it uses its generator after the call, and keeps that stream afterwards.
+    /// The values drawn from ThreadRandom by a task depend on the thread that runs it
+    /// and on the tasks that thread ran before. Tasks scheduled dynamically must draw
+    /// from their own generator, seeded from RandomSeed and the task, for runs to be
+    /// reproducible: the contact generation passes one to the heuristics through
+    /// sampling::HeuristicParam::generator_.
+    /// Threads that are not part of an OpenMP team all draw from stream 0.
+    /// Must not be called while other threads draw values.
+    void HPP_RBPRM_DLLAPI SeedRandom(const boost::uint64_t seed);
+
+    /// \return the last seed given to SeedRandom, 0 if it was never called
+    boost::uint64_t HPP_RBPRM_DLLAPI RandomSeed();
+
+    /// \return the random generator of the calling thread. Drawing from it
+    /// does not require any synchronization.
+    RandomGenerator& HPP_RBPRM_DLLAPI ThreadRandom();
+  } // namespace rbprm
+} // namespace hpp
+
+#endif // HPP_RBPRM_RANDOM_HH
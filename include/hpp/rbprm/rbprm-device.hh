@@ -59,6 +59,13 @@ namespace hpp {
         /// \return a smart pointer to the created RbPrmDevice
         static RbPrmDevicePtr_t create (const std::string& name, const T_Rom& robotRoms);
 
+        /// Creates a copy of a RbPrmDevice, with copies of its ROMs, so that
+        /// the copy can be used concurrently with the original
+        ///
+        /// \param device: the copied device
+        /// \return a smart pointer to the created RbPrmDevice
+        static RbPrmDevicePtr_t createCopy (const RbPrmDevicePtr_t& device);
+
     public:
         virtual ~RbPrmDevice();
 
@@ -76,12 +83,18 @@ namespace hpp {
 
     protected:
       RbPrmDevice (const std::string& name, const T_Rom& robotRoms);
+      RbPrmDevice (const RbPrmDevice& device, const T_Rom& robotRoms);
 
       ///
       /// \brief Initialization.
       ///
       void init (const RbPrmDeviceWkPtr_t& weakPtr);
 
+      ///
+      /// \brief Initialization of a copy.
+      ///
+      void initCopy (const RbPrmDeviceWkPtr_t& weakPtr, const RbPrmDevice& model);
+
     private:
       RbPrmDeviceWkPtr_t weakPtr_;
     }; // class RbPrmDevice
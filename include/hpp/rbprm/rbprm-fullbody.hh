@@ -26,6 +26,7 @@
 #include <hpp/core/collision-validation.hh>
 #include <hpp/rbprm/sampling/heuristic.hh>
 #include <hpp/rbprm/reports.hh>
+#include <hpp/rbprm/affordance-index.hh>
 
 #include  <vector>
 
@@ -48,6 +49,21 @@ namespace hpp {
     public:
         static RbPrmFullBodyPtr_t create (const model::DevicePtr_t& device);
 
+        /// Creates a copy of a robot for a copy of its device. The copy has its own limbs
+        /// and collision validations, and shares the limb databases of fullBody.
+        /// The collision validations have the same collision pairs as those of fullBody,
+        /// including obstacles added or pairs removed after AddLimb.
+        ///
+        /// \param fullBody copied robot, only read
+        /// \param device copy of fullBody.device_
+        static RbPrmFullBodyPtr_t createCopy (const RbPrmFullBody& fullBody, const model::DevicePtr_t& device);
+
+    public:
+        /// Creates a copy of the robot, typically used by another thread:
+        /// createCopy on a clone of device_, with the same sharing of the limb databases.
+        /// Can be called concurrently by several threads.
+        RbPrmFullBodyPtr_t clone () const;
+
     public:
         virtual ~RbPrmFullBody();
 
@@ -72,12 +88,13 @@ namespace hpp {
         /// This can be problematic in terms of performance. The default value is 3 cm.
         /// \param resolution, resolution of the octree voxels. The samples generated are stored in an octree data
         /// \param disableEffectorCollision, whether collision detection should be disabled for end effector bones
+        /// \param keepJacobians whether the jacobians of the samples are stored, see sampling::DropJacobians
         void AddLimb(const std::string& id, const std::string& name, const std::string& effectorName, const fcl::Vec3f &offset,
                      const fcl::Vec3f &normal,const double x, const double y,
                      const model::ObjectVector_t &collisionObjects,
                      const std::size_t nbSamples, const std::string& heuristic = "static", const double resolution = 0.03,
                      ContactType contactType = _6_DOF, const bool disableEffectorCollision = false,
-                     const bool grasp = false);
+                     const bool grasp = false, const bool keepJacobians = true);
 
         /// Creates a Limb for the robot,
         /// identified by its name. Stores a sample
@@ -102,20 +119,39 @@ namespace hpp {
         /// \return whether the heuristic has been added. False is returned if a heuristic with that name already exists.
         bool AddHeuristic(const std::string& name, const sampling::heuristic func);
 
+        /// Copies of the robot used by the parallel contact generation, created on demand.
+        /// Each worker owns a copy of device_, of the limbs and of the collision validations,
+        /// so that workers can be used concurrently. The limb databases are shared.
+        /// Workers are updated with the current parameters of the robot at each call,
+        /// which must not happen in a parallel region. They are created again when the
+        /// collision pairs of the validations have changed since the last call.
+        ///
+        /// \param nbWorkers minimum number of workers returned
+        const std::vector<RbPrmFullBodyPtr_t>& workers(const std::size_t nbWorkers);
+
     public:
         typedef std::map<std::string, std::vector<std::string> > T_LimbGroup;
 
     public:
-        const rbprm::T_Limb& GetLimbs() {return limbs_;}
-        const T_LimbGroup& GetGroups() {return limbGroups_;}
-        const core::CollisionValidationPtr_t& GetCollisionValidation() {return collisionValidation_;}
-        const std::map<std::string, core::CollisionValidationPtr_t>& GetLimbCollisionValidation() {return limbcollisionValidations_;}
+        const rbprm::T_Limb& GetLimbs() const {return limbs_;}
+        const T_LimbGroup& GetGroups() const {return limbGroups_;}
+        const core::CollisionValidationPtr_t& GetCollisionValidation() const {return collisionValidation_;}
+        const std::map<std::string, core::CollisionValidationPtr_t>& GetLimbCollisionValidation() const {return limbcollisionValidations_;}
         const model::DevicePtr_t device_;
+        /// Broad phase over the affordances of the scene, shared by the contact generations.
+        /// The index is built on the first request for a scene, and rebuilt only when
+        /// the affordances change.
+        /// \param affordances affordance objects of the scene
+        /// \return an index of these affordances
+        AffordanceIndexPtr_t affordanceIndex(const affMap_t& affordances);
+        /// Publishes the index of the scene, typically RbPrmShooter::affordanceIndex_,
+        /// so that the root path planning and the contact generation share it.
+        void affordanceIndex(const AffordanceIndexPtr_t& affordanceIndex);
         void staticStability(bool staticStability){staticStability_ = staticStability;}
-        const bool staticStability(){return staticStability_;}
-        const double getFriction(){return mu_;}
+        const bool staticStability() const {return staticStability_;}
+        const double getFriction() const {return mu_;}
         void setFriction(double mu){mu_ = mu;}
-        const model::ConfigurationPtr_t referenceConfig(){return referenceConfig_;}
+        const model::ConfigurationPtr_t referenceConfig() const {return referenceConfig_;}
         void referenceConfig(model::ConfigurationPtr_t referenceConfig){referenceConfig_=referenceConfig;}
 
     private:
@@ -127,6 +163,14 @@ namespace hpp {
         bool staticStability_;
         double mu_;
         model::ConfigurationPtr_t referenceConfig_;
+        AffordanceIndexPtr_t affordanceIndex_;
+
+        /// collision objects of the limbs, in the order the limbs were added
+        std::vector<std::pair<std::string, model::ObjectVector_t> > limbObstacles_;
+        std::vector<RbPrmFullBodyPtr_t> workers_;
+        /// collision pairs of the validations copied by workers_, by limb id.
+        /// Those of collisionValidation_ have an empty id
+        std::map<std::string, core::CollisionPairs_t> workersPairs_;
 
     private:
         void AddLimbPrivate(rbprm::RbPrmLimbPtr_t limb, const std::string& id, const std::string& name,
@@ -135,6 +179,9 @@ namespace hpp {
     protected:
       RbPrmFullBody (const model::DevicePtr_t &device);
 
+      /// Copy of a robot for a copy of its device, see createCopy
+      RbPrmFullBody (const RbPrmFullBody& fullBody, const model::DevicePtr_t &device);
+
       ///
       /// \brief Initialization.
       ///
@@ -21,6 +21,7 @@
 
 # include <hpp/rbprm/config.hh>
 # include <hpp/rbprm/sampling/sample-db.hh>
+# include <hpp/rbprm/sampling/sample-db-refiner.hh>
 # include <hpp/rbprm/sampling/heuristic.hh>
 # include <hpp/model/device.hh>
 
@@ -87,24 +88,58 @@ namespace hpp {
         /// This can be problematic in terms of performance. The default value is 3 cm.
         /// \param contactType Whether the contact is a surface contact (orientation matters) or a punctual contact
         /// \param disableEndEffectorCollision Whether the end effector bodies should be counted for collision detection
+        /// \param keepJacobians whether the jacobians of the samples are stored, see sampling::DropJacobians
         static RbPrmLimbPtr_t create (const model::JointPtr_t limb, const std::string& effectorName, const fcl::Vec3f &offset,
                                       const fcl::Vec3f &normal,const double x, const double y,
                                       const std::size_t nbSamples, const sampling::heuristic evaluate = 0,
                                       const double resolution = 0.1, ContactType contactType = _6_DOF,
                                       bool disableEndEffectorCollision = false,
-                                      bool grasps = false);
+                                      bool grasps = false, const bool keepJacobians = true);
 
         static RbPrmLimbPtr_t create (const model::DevicePtr_t device, std::ifstream& fileStream, const bool loadValues = true,
                                       const hpp::rbprm::sampling::heuristic evaluate = 0,
                                       bool disableEndEffectorCollision = false,
                                       bool grasps = false);
 
+        /// Creates a limb from a database in binary format. The limb information
+        /// is read from fileStream, and the sample database is memory mapped from
+        /// the same file, starting at the current position of the stream.
+        ///
+        /// \param fileStream stream positioned after the binary database tag
+        /// \param fileName path of the file read by fileStream
+        static RbPrmLimbPtr_t create (const model::DevicePtr_t device, std::ifstream& fileStream, const std::string& fileName,
+                                      const bool loadValues = true,
+                                      const hpp::rbprm::sampling::heuristic evaluate = 0,
+                                      bool disableEndEffectorCollision = false,
+                                      bool grasps = false);
+
+        /// Creates a copy of a limb for a copy of its robot. Only the joints of the limb
+        /// are taken from the copied robot: the sample database, its orientation index
+        /// and its refiner are shared with the original limb, and are not copied.
+        ///
+        /// \param limb copied limb
+        /// \param device copy of the robot of the limb
+        static RbPrmLimbPtr_t createCopy (const RbPrmLimbPtr_t& limb, const model::DevicePtr_t& device);
+
     public:
         ~RbPrmLimb();
 
     public:
         fcl::Transform3f octreeRoot() const;
 
+        /// Orientation index of sampleContainer_, empty unless the limb is _6_DOF.
+        /// The index requires a forward kinematics pass over all the samples, so it is
+        /// only built on the first call, using the device of the limb.
+        /// Thread safe, as long as the device of the limb is not used by another thread.
+        const sampling::OrientationBins& orientationBins() const;
+
+        /// Enables the online refinement of sampleContainer_, see sampling::SampleDBRefiner.
+        /// The refiner copies the robot of the limb, which must not be in use during the call
+        /// \param data evaluation of the values of sampleContainer_. Refinements may run while the robot
+        /// is in use, so the evaluations must not access it: use AnalysisFactory::CopyEvaluations
+        /// \param staticValue name of the value used as the static value of the samples
+        void enableRefinement(const sampling::T_evaluate& data = sampling::T_evaluate(), const std::string& staticValue ="");
+
     public:
         const model::JointPtr_t limb_;
         const model::JointPtr_t effector_;
@@ -115,7 +150,14 @@ namespace hpp {
         const double y_; // half length of contact surface
         const ContactType contactType_;
         sampling::heuristic evaluate_;
-        const sampling::SampleDB sampleContainer_;
+        /// sample database, shared by the copies of the limb
+        const boost::shared_ptr<const sampling::SampleDB> database_;
+        const sampling::SampleDB& sampleContainer_;
+        /// orientation index of sampleContainer_, null until built by orientationBins().
+        /// Shared by the copies of the limb
+        const boost::shared_ptr<boost::shared_ptr<const sampling::OrientationBins> > orientations_;
+        /// online refinement of sampleContainer_, null unless enabled
+        sampling::SampleDBRefinerPtr_t refiner_;
         const bool disableEndEffectorCollision_;
         const bool grasps_;
 
@@ -126,12 +168,19 @@ namespace hpp {
                  const std::size_t nbSamples, const sampling::heuristic evaluate,
                  const double resolution, ContactType contactType,
                  bool disableEndEffectorCollision = false,
-                 bool grasps = false);
+                 bool grasps = false, const bool keepJacobians = true);
 
       RbPrmLimb (const model::DevicePtr_t device, std::ifstream& fileStream, const bool loadValues,
                  const hpp::rbprm::sampling::heuristic evaluate,
                  bool disableEndEffectorCollision = false,
                  bool grasps = false);
+
+      RbPrmLimb (const model::DevicePtr_t device, std::ifstream& fileStream, const std::string& fileName,
+                 const bool loadValues, const hpp::rbprm::sampling::heuristic evaluate,
+                 bool disableEndEffectorCollision = false,
+                 bool grasps = false);
+
+      RbPrmLimb (const RbPrmLimb& limb, const model::DevicePtr_t& device);
       ///
       /// \brief Initialization.
       ///
@@ -144,6 +193,23 @@ namespace hpp {
 
     HPP_RBPRM_DLLAPI bool saveLimbInfoAndDatabase(const RbPrmLimbPtr_t limb, std::ofstream& dbFile);
 
+    /// Saves the limb information followed by its sample database in binary format.
+    /// The file starts with a tag identifying the format, see isBinaryLimbDatabase.
+    /// \param dbFile output stream, opened in binary mode
+    HPP_RBPRM_DLLAPI bool saveLimbInfoAndDatabaseBinary(const RbPrmLimbPtr_t limb, std::ofstream& dbFile);
+
+    /// Checks whether a limb database file is in binary format.
+    /// If so, the stream is left positioned after the format tag,
+    /// otherwise it is rewinded to the beginning of the file.
+    HPP_RBPRM_DLLAPI bool isBinaryLimbDatabase(std::ifstream& dbFile);
+
+    /// Converts a limb database saved with saveLimbInfoAndDatabase into
+    /// the binary format. No robot is required for the conversion.
+    /// \param textDatabase path to the existing text database
+    /// \param binaryDatabase path to the binary database to write
+    /// \return true if the conversion succeeded
+    HPP_RBPRM_DLLAPI bool convertLimbDatabase(const std::string& textDatabase, const std::string& binaryDatabase);
+
   } // namespace rbprm
 } // namespace hpp
 
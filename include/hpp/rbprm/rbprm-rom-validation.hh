@@ -21,8 +21,12 @@
 
 # include <hpp/core/collision-validation.hh>
 # include <hpp/rbprm/rbprm-device.hh>
+# include <hpp/rbprm/affordance-index.hh>
 # include <hpp/rbprm/config.hh>
 
+# include <map>
+# include <vector>
+
 namespace hpp {
   namespace rbprm {
 
@@ -67,12 +71,45 @@ namespace hpp {
       const std::vector<std::string> filter_;
 
       void setOptional(bool optional){optional_ = optional;}
+
+      /// Sets a broad phase over the affordance obstacles. Indexed obstacles
+      /// are then only tested if their AABB overlaps the AABB of the rom.
+      /// Obstacles that are not in the index are always tested.
+      void setAffordanceIndex(const AffordanceIndexPtr_t& affordanceIndex)
+      {
+          affordanceIndex_ = affordanceIndex;
+          pairsChanged_ = true;
+      }
+
+      virtual void addObstacle (const core::CollisionObjectPtr_t& object);
+
+      virtual void removeObstacleFromJoint
+    (const core::JointPtr_t& joint, const core::CollisionObjectPtr_t& obstacle);
     protected:
       RbPrmRomValidation (const model::DevicePtr_t &robot,
                        const std::vector<std::string>& affFilters);
     private:
+      /// Same as CollisionValidation::validate, only testing the indexed obstacles
+      /// returned by a query of the affordance index, and the obstacles not indexed
+      bool validateNearbyObstacles (const core::Configuration_t& config, core::ValidationReportPtr_t& validationReport);
+      /// sorts collisionPairs_ for validateNearbyObstacles
+      void updateNearbyPairs ();
+
+    private:
+      typedef std::vector<core::CollisionPair_t> T_Pairs;
       core::ValidationReportPtr_t unusedReport_;
       bool optional_;
+      AffordanceIndexPtr_t affordanceIndex_;
+      /// whether collisionPairs_ changed since the last call to updateNearbyPairs.
+      /// Pairs filtered by filterCollisionPairs are detected by the size of collisionPairs_
+      bool pairsChanged_;
+      std::size_t nbPairs_;
+      /// distinct objects of the rom in collisionPairs_
+      model::ObjectVector_t romObjects_;
+      /// pairs of collisionPairs_ with an indexed obstacle, by obstacle
+      std::map<model::CollisionObjectPtr_t, T_Pairs> indexedPairs_;
+      /// pairs of collisionPairs_ with an obstacle not in the index
+      T_Pairs unindexedPairs_;
 
     }; // class RbPrmValidation
     /// \}
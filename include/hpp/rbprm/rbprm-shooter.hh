@@ -20,6 +20,7 @@
 # include <hpp/rbprm/config.hh>
 # include <hpp/rbprm/rbprm-device.hh>
 # include <hpp/rbprm/rbprm-validation.hh>
+# include <hpp/rbprm/random.hh>
 # include <hpp/model/joint.hh>
 # include <hpp/model/joint-configuration.hh>
 # include <hpp/core/configuration-shooter.hh>
@@ -33,6 +34,34 @@ namespace hpp {
     {
         fcl::Vec3f p1, p2, p3;
     };
+    /// Triangles of the environment, stored as arrays of vertices and normals.
+    /// Triangles can be drawn according to their area in constant time, with an alias table.
+    class HPP_RBPRM_DLLAPI TriangleTable
+    {
+    public:
+        /// \param geometries triangle meshes of the environment
+        explicit TriangleTable(const model::ObjectVector_t& geometries);
+
+        std::size_t size() const;
+        /// \return the index of a triangle chosen uniformly
+        std::size_t uniformTriangle(RandomGenerator& generator) const;
+        /// \return the index of a triangle chosen with a probability proportional to its area
+        std::size_t weightedTriangle(RandomGenerator& generator) const;
+        /// \return a point uniformly distributed on a triangle
+        fcl::Vec3f samplePoint(const std::size_t triangle, RandomGenerator& generator) const;
+        fcl::Vec3f normal(const std::size_t triangle) const;
+
+    public:
+        /// world positions of the vertices, one triangle per column
+        Eigen::Matrix<double, 3, Eigen::Dynamic> p1_, p2_, p3_;
+        /// unit normals of the triangles, computed using the blender convention
+        Eigen::Matrix<double, 3, Eigen::Dynamic> normals_;
+        /// alias table: a uniformly chosen triangle i is kept with probability
+        /// probabilities_[i], and replaced by aliases_[i] otherwise
+        std::vector<double> probabilities_;
+        std::vector<std::size_t> aliases_;
+    }; // class TriangleTable
+
     HPP_PREDEF_CLASS (RbPrmShooter);
     typedef boost::shared_ptr <RbPrmShooter>
     RbPrmShooterPtr_t;
@@ -70,6 +99,18 @@ namespace hpp {
                                          const std::size_t displacementLimit = 100);
     virtual core::ConfigurationPtr_t shoot () const;
 
+        /// Shoots several configurations in parallel. Each thread validates its shots
+        /// with its own copy of the robot and of the validation, created on the first call.
+        /// Each shot draws from its own random stream, so that the result does not depend on
+        /// the scheduling of the threads. Concurrent calls must be serialized.
+        ///
+        /// \param n number of configurations
+        /// \param configurations output, one configuration per column. Only resized
+        /// if it does not have n columns of the size of a configuration
+        /// \param valid output, whether each configuration verifies the reachability condition
+        /// \return number of valid configurations
+        std::size_t shootBatch (const std::size_t n, Eigen::MatrixXd& configurations, std::vector<bool>& valid) const;
+
 
     public:
         /// Sets limits on robot orientation, described according to Euler's ZYX rotation order
@@ -86,6 +127,9 @@ namespace hpp {
         const std::size_t shootLimit_;
         const std::size_t displacementLimit_;
         const std::vector<std::string> filter_;
+        /// Broad phase over the affordances, built once for the scene.
+        /// Publish it with RbPrmFullBody::affordanceIndex so that contact generation reuses it.
+        const AffordanceIndexPtr_t affordanceIndex_;
 
 
     protected:
@@ -101,17 +145,32 @@ namespace hpp {
     void init (const RbPrmShooterPtr_t& self);
 
     private:
-        void InitWeightedTriangles (const model::ObjectVector_t &geometries);
-        const T_TriangleNormal& RandomPointIntriangle () const;
-        const T_TriangleNormal& WeightedTriangle () const;
+        std::size_t RandomPointIntriangle (RandomGenerator& generator) const;
+        std::size_t WeightedTriangle (RandomGenerator& generator) const;
+        /// Shoots a configuration, validated with validator
+        /// \return whether a valid configuration was found within shootLimit_ trials
+        bool shoot (core::ConfigurationPtr_t config, RbPrmValidation& validator, RandomGenerator& generator) const;
+
+        /// validation of the shots of a thread of shootBatch, on its own copy of the robot
+        struct BatchValidation
+        {
+            model::RbPrmDevicePtr_t robot_;
+            RbPrmValidationPtr_t validator_;
+        };
 
     private:
-        std::vector<double> weights_;
-        std::vector<T_TriangleNormal> triangles_;
+        const TriangleTable triangles_;
         const model::RbPrmDevicePtr_t robot_;
         rbprm::RbPrmValidationPtr_t validator_;
         RbPrmShooterWkPtr_t weak_;
         model::DevicePtr_t eulerSo3_;
+        /// parameters of the validation, to build the copies used by shootBatch
+        const core::ObjectVector_t geometries_;
+        const affMap_t affordances_;
+        const std::map<std::string, std::vector<std::string> > affFilters_;
+        mutable std::vector<BatchValidation> batchValidations_;
+        /// number of configurations shot by shootBatch, to give new random streams to each batch
+        mutable std::size_t nbBatchShots_;
     }; // class RbprmShooter
 /// \}
     } // namespace rbprm
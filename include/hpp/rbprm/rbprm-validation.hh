@@ -49,7 +49,8 @@ namespace hpp {
 																					const std::map<std::string, std::vector<model::CollisionObjectPtr_t> >& affordances = 
 																						std::map<std::string, std::vector<model::CollisionObjectPtr_t> >(),
 																					const core::ObjectVector_t& geometries =
-																						core::ObjectVector_t());
+																						core::ObjectVector_t(),
+                                          const AffordanceIndexPtr_t& affordanceIndex = AffordanceIndexPtr_t());
 
       /// Compute whether the configuration is valid
       ///
@@ -161,6 +162,8 @@ namespace hpp {
       /// CollisionValidation for the range of motion of the limbs
       const T_RomValidation romValidations_;
       std::vector<std::string> defaultFilter_;
+      /// Broad phase over the affordances, shared by the rom validations
+      const AffordanceIndexPtr_t affordanceIndex_;
 
     protected:
       RbPrmValidation (const model::RbPrmDevicePtr_t& robot,
@@ -169,7 +172,8 @@ namespace hpp {
 											 	std::vector<std::string> >& affFilters,
 											 const std::map<std::string, 
 												std::vector<model::CollisionObjectPtr_t> >& affordances,
-											 const core::ObjectVector_t& geometries);
+											 const core::ObjectVector_t& geometries,
+                       const AffordanceIndexPtr_t& affordanceIndex);
 
 											 
     private:
@@ -37,7 +37,23 @@ namespace hpp {
       ~AnalysisFactory();
 
        bool AddAnalysis(const std::string& name, const evaluate func);
+       /// Copy of evaluate_ where the analyses of the robot use a clone of device_,
+       /// owned by the returned evaluations. Used to refine a database while device_ is in use,
+       /// see RbPrmLimb::enableRefinement. Analyses added with AddAnalysis are copied as is.
+       /// device_ must not be in use during the call.
+       T_evaluate CopyEvaluations() const;
+       /// Computes in parallel all the jacobian analyses (manipulability, isotropy,
+       /// minimum and maximum singular values for the whole, rotational and
+       /// translational jacobians), with a single SVD per sample and jacobian.
+       /// Values already present in the database are not recomputed.
+       /// If the jacobians of the samples were dropped, they are computed again on a copy
+       /// of the robot per thread, which must then not be in use during the call.
+       /// \param database database to annotate
+       /// \param sortSamples whether samples must be sorted again after the evaluation
+       SampleDB& AddJacobianAnalyses(SampleDB& database, bool sortSamples = true) const;
        T_evaluate evaluate_;
+       /// names of the values computed by AddJacobianAnalyses
+       std::vector<std::string> jacobianAnalyses_;
        rbprm::RbPrmFullBodyPtr_t device_;
   };
   } // namespace sampling
@@ -2,12 +2,34 @@
 #define HPP_HEURISTIC_TOOLS_HH
 
 #include <hpp/model/device.hh> // way to get the includes of fcl, ...
+#include <hpp/rbprm/random.hh>
+#include <boost/shared_ptr.hpp>
 #include <map>
 
 namespace hpp{
 namespace rbprm{
 namespace sampling{
     
+    /// Data structure to store 2-dimensional informations (2D vectors)
+    struct Vec2D
+    {
+        double x;
+        double y;
+        Vec2D() : x(0), y(0) {}
+        Vec2D(double xx, double yy) : x(xx), y(yy) {}
+        Vec2D(const Vec2D & c2D) : x(c2D.x), y(c2D.y) {}
+        Vec2D & operator=(const Vec2D & c);
+        double operator[](int idx) const;
+        double & operator[](int idx);
+        static double euclideanDist(const Vec2D & v1, const Vec2D & v2);
+    };
+    bool operator==(const Vec2D & v1, const Vec2D & v2);
+    bool operator!=(const Vec2D & v1, const Vec2D & v2);
+    std::ostream & operator<<(std::ostream & out, const Vec2D & v);
+
+    struct HeuristicContext;
+    typedef boost::shared_ptr <const HeuristicContext> HeuristicContextPtr_t;
+
     /// Defines a parameters set for the ZMP-based heuristic
     struct HeuristicParam
     {
@@ -18,14 +40,73 @@ namespace sampling{
         std::string sampleLimbName_; // The name of the considered sample
         fcl::Transform3f tfWorldRoot_; // The transform between the world coordinate system and the root of the robot
 
-        HeuristicParam() {}
+        HeuristicParam() : generator_(0) {}
         HeuristicParam(const std::map<std::string, fcl::Vec3f> & cp, const fcl::Vec3f & comPos, const fcl::Vec3f & comSp, const fcl::Vec3f & comAcc,
                           const std::string & sln, const fcl::Transform3f & tf);
         HeuristicParam(const HeuristicParam & zhp);
 
         HeuristicParam & operator=(const HeuristicParam & zhp);
+
+        /// Builds context_ from the other fields. Must be called again if they are modified
+        /// \param groundThreshold height above the lowest contact above which contacts are not on the ground
+        void prepare(const double groundThreshold = 0.25);
+
+        /// data derived from the other fields, shared by the copies of the parameters.
+        /// Null unless prepare is called
+        HeuristicContextPtr_t context_;
+
+        /// generator the random heuristics draw from, owned by the task evaluating the candidates.
+        /// If null, they draw from ThreadRandom, and the values depend on the scheduling of the threads
+        RandomGenerator* generator_;
+
+        /// \return generator_, or the generator of the calling thread if it is null
+        RandomGenerator& generator() const;
     };
 
+    /// Data derived from a HeuristicParam, which does not depend on the candidate sample.
+    /// It is built once per contact query, and is not modified afterwards, so that
+    /// the candidates can be evaluated concurrently.
+    struct HeuristicContext
+    {
+        /// largest number of contacts for which the support polygons are precomputed
+        static const std::size_t maxContacts = 63;
+
+        /// \param params parameters of the query
+        /// \param groundThreshold height above the lowest contact above which contacts are not on the ground
+        HeuristicContext(const HeuristicParam & params, const double groundThreshold);
+
+        /// \return the position of a point of the root frame in the world frame
+        fcl::Vec3f toWorld(const fcl::Vec3f & p) const;
+
+        /// Computes the weighted centroid of the support polygon of the ground contacts,
+        /// including the candidate. Does not allocate memory.
+        /// Requires hulls_ not to be empty.
+        /// \param candidate world position of the effector of the candidate sample
+        Vec2D centroid(const fcl::Vec3f & candidate) const;
+
+        /// names of the other contacts, in the order of contactPositions_
+        std::vector<std::string> contactNames_;
+        /// world positions of the other contacts, one per column
+        Eigen::Matrix<double, 3, Eigen::Dynamic> contactPositions_;
+        /// transform between the world coordinate system and the root of the robot
+        Eigen::Matrix3d worldRotation_;
+        Eigen::Vector3d worldTranslation_;
+        /// true if the other contacts already contain a contact for the limb of the sample
+        bool candidateIgnored_;
+        double groundThreshold_;
+        /// point the centroid of the support polygon should be close to
+        Vec2D interest_;
+        /// heights of the other contacts, by increasing value
+        std::vector<double> heights_;
+        /// hulls_[k]: counterclockwise convex hull of the k lowest other contacts.
+        /// Empty if there are more than maxContacts contacts
+        std::vector<std::vector<Vec2D> > hulls_;
+    };
+
+    /// Computes the point the weighted centroid of the support polygon should be close to,
+    /// according to the CoM position, speed and acceleration
+    Vec2D computeInterestPoint(const fcl::Vec3f & comPosition, const fcl::Vec3f & comSpeed, const fcl::Vec3f & comAcceleration);
+
     /// Computes the transform of a point
     ///
     /// \param p The considered point
@@ -34,23 +115,6 @@ namespace sampling{
     /// \return The transformed point
     fcl::Vec3f transform(const fcl::Vec3f & p, const fcl::Vec3f & tr, const fcl::Matrix3f & ro);
 
-    /// Data structure to store 2-dimensional informations (2D vectors)
-    struct Vec2D
-    {
-        double x;
-        double y;
-        Vec2D() : x(0), y(0) {}
-        Vec2D(double xx, double yy) : x(xx), y(yy) {}
-        Vec2D(const Vec2D & c2D) : x(c2D.x), y(c2D.y) {}
-        Vec2D & operator=(const Vec2D & c);
-        double operator[](int idx) const;
-        double & operator[](int idx);
-        static double euclideanDist(const Vec2D & v1, const Vec2D & v2);
-    };
-    bool operator==(const Vec2D & v1, const Vec2D & v2);
-    bool operator!=(const Vec2D & v1, const Vec2D & v2);
-    std::ostream & operator<<(std::ostream & out, const Vec2D & v);
-
     /// Function to verify the existence of an element in a std::vector
     template <typename T>
     bool contains(const std::vector <T> & vect, const T & val)
@@ -104,6 +168,19 @@ namespace sampling{
     /// \return The weighted centroid of the specified convex polygon
     Vec2D weightedCentroidConvex2D(const std::vector <Vec2D> & convexPolygon);
 
+    /// Same as weightedCentroidConvex2D, without memory allocation
+    /// \param convexPolygon the vertices of the convex polygon
+    /// \param size number of vertices, at least 1
+    Vec2D weightedCentroidConvex2D(const Vec2D* convexPolygon, const std::size_t size);
+
+    /// Adds a point to a counterclockwise convex hull, without memory allocation
+    /// \param hull the vertices of the hull
+    /// \param size number of vertices of the hull
+    /// \param point the added point
+    /// \param result output, with room for size + 1 vertices
+    /// \return the number of vertices of the resulting hull
+    std::size_t addToConvexHull(const Vec2D* hull, const std::size_t size, const Vec2D& point, Vec2D* result);
+
     /// Remove the contacts that does not belong to the "ground"
     ///
     /// \param contacts The considered contacts map
@@ -40,6 +40,19 @@ namespace hpp {
   typedef double (*heuristic) (const sampling::Sample& sample,
                                const Eigen::Vector3d& direction, const Eigen::Vector3d& normal, const HeuristicParam & params);
 
+  /// Same as heuristic, scoring a range of consecutive samples of a SampleDB,
+  /// typically all the samples of a voxel.
+  /// \param samples samples of the SampleDB
+  /// \param first index of the first sample
+  /// \param count number of samples
+  /// \param values output, values[i] is the score of sample first + i
+  typedef void (*batchHeuristic) (const sampling::SampleVector_t& samples, const std::size_t first, const std::size_t count,
+                                  const Eigen::Vector3d& direction, const Eigen::Vector3d& normal, const HeuristicParam & params,
+                                  double* values);
+
+  /// \return the batch version of a built-in heuristic, 0 if there is none
+  HPP_RBPRM_DLLAPI batchHeuristic GetBatchHeuristic(const heuristic evaluate);
+
   /// Defines a set of existing heuristics for biasing the sample candidate selection
   ///
   /// This class defines two heuristics by default. "EFORT" and "manipulability".
@@ -50,6 +63,8 @@ namespace hpp {
 
        bool AddHeuristic(const std::string& name, const heuristic func);
        std::map<std::string, const heuristic> heuristics_;
+       /// Built-in heuristics with a batch version
+       std::map<std::string, const batchHeuristic> batchHeuristics_;
   };
 
   } // namespace sampling
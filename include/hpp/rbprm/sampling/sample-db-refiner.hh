@@ -0,0 +1,141 @@
+//
+// Copyright (c) 2014 CNRS
+// Authors: Steve Tonneau (steve.tonneau@laas.fr)
+//
+// This file is part of hpp-rbprm.
+// hpp-rbprm is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-rbprm is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-core  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef HPP_RBPRM_SAMPLEDB_REFINER_HH
+# define HPP_RBPRM_SAMPLEDB_REFINER_HH
+
+#include <hpp/rbprm/config.hh>
+#include <hpp/rbprm/sampling/sample-db.hh>
+#include <boost/cstdint.hpp>
+#include <map>
+
+namespace hpp {
+
+  namespace rbprm {
+  namespace sampling{
+
+    HPP_PREDEF_CLASS(SampleDBRefiner);
+    typedef boost::shared_ptr <SampleDBRefiner> SampleDBRefinerPtr_t;
+
+    /// A database generated by a SampleDBRefiner, with its orientation index.
+    class HPP_RBPRM_DLLAPI RefinedSampleDB
+    {
+    public:
+        RefinedSampleDB(const SampleVector_t& samples, const double resolution, const T_evaluate& data, const std::string& staticValue,
+                        const model::JointPtr_t limb, const model::JointPtr_t effector, const fcl::Vec3f& normal, const bool orientations);
+
+    public:
+        const SampleDB database_;
+        /// orientation index of database_, empty if the limb has none
+        const OrientationBins orientationBins_;
+    }; // class RefinedSampleDB
+    typedef boost::shared_ptr <const RefinedSampleDB> RefinedSampleDBPtr_t;
+
+    /// Number of times the samples of a voxel were tried for a contact, and
+    /// number of times they gave a valid contact.
+    struct VoxelStatistics
+    {
+        VoxelStatistics() : hits_(0), successes_(0) {}
+        std::size_t hits_;
+        std::size_t successes_;
+    };
+    /// statistics by octomap key of the voxel. Keys only depend on the resolution,
+    /// so that they remain valid across refinements
+    typedef std::map<boost::uint64_t, VoxelStatistics> T_VoxelStatistics;
+
+    /// Online densification of the sample database of a limb.
+    /// Contact generation records which voxels its candidates come from, and whether they
+    /// succeeded. refine then generates additional samples in the voxels that were used the most,
+    /// and builds a new database with the previous samples and the new ones.
+    /// The new database is published with an atomic pointer swap: readers acquire the current
+    /// version with current, and keep using it while a refinement is running.
+    /// A version is released when its last reader releases it.
+    /// Samples are generated on a copy of the robot owned by the refiner, and the values of the
+    /// new samples are computed by evaluations that must not use the robot of the limb either,
+    /// so that refine does not access the robot of the limb, which may be in use.
+    class HPP_RBPRM_DLLAPI SampleDBRefiner
+    {
+    public:
+        /// \param database initial database of the limb
+        /// \param limb root of the limb. Its robot is copied: it must not be in use during the call
+        /// \param effector effector joint of the limb
+        /// \param offset location of the contact point, relatively to the effector joint
+        /// \param normal contact normal of the effector, in the effector frame
+        /// \param orientations whether refined databases must have an orientation index
+        /// \param data evaluation of the values of the database. All values of database must be provided.
+        /// They are called by refine, and must not access the robot of the limb: evaluations using
+        /// a robot must be bound to a copy of it, see AnalysisFactory::CopyEvaluations
+        /// \param staticValue name of the value used as the static value of the samples
+        static SampleDBRefinerPtr_t create(const SampleDBPtr_t& database, const model::JointPtr_t limb, const model::JointPtr_t effector,
+                                           const fcl::Vec3f& offset, const fcl::Vec3f& normal, const bool orientations,
+                                           const T_evaluate& data = T_evaluate(), const std::string& staticValue ="");
+
+    public:
+        /// \return the last refined database, null if refine has not been called yet,
+        /// in which case the initial database is current. Thread safe.
+        RefinedSampleDBPtr_t current() const;
+
+        /// Records that a sample was tried for a contact. Thread safe.
+        /// \param sample sample of the initial database or of a refined one
+        void recordHit(const Sample& sample);
+        /// Records that a sample gave a valid contact. Thread safe.
+        void recordSuccess(const Sample& sample);
+        /// \return a copy of the statistics recorded so far
+        T_VoxelStatistics statistics() const;
+
+        /// Generates new samples in the voxels tried at least minHits times, and publishes a database
+        /// containing all the samples. Samples are drawn uniformly in the configuration space of the limb,
+        /// and those whose effector is not in one of these voxels are rejected.
+        /// Can run in a background thread while the current database is used.
+        /// Concurrent calls are serialized.
+        /// \param nbSamples number of samples to add
+        /// \param minHits minimum number of hits of a refined voxel
+        /// \param seed seed of the random generator
+        /// \return number of samples added, 0 if no voxel was hot enough
+        std::size_t refine(const std::size_t nbSamples, const std::size_t minHits = 1, const unsigned long long seed = 0);
+
+    protected:
+        SampleDBRefiner(const SampleDBPtr_t& database, const model::JointPtr_t limb, const model::JointPtr_t effector,
+                        const fcl::Vec3f& offset, const fcl::Vec3f& normal, const bool orientations,
+                        const T_evaluate& data, const std::string& staticValue);
+
+    private:
+        boost::uint64_t key(const Sample& sample) const;
+
+    private:
+        const SampleDBPtr_t initial_;
+        /// copy of the robot of the limb, only used by refine
+        const model::DevicePtr_t device_;
+        /// joints of the limb in device_
+        const model::JointPtr_t limb_;
+        const model::JointPtr_t effector_;
+        const fcl::Vec3f offset_;
+        const fcl::Vec3f normal_;
+        const bool orientations_;
+        const T_evaluate data_;
+        const std::string staticValue_;
+        RefinedSampleDBPtr_t current_;
+        T_VoxelStatistics statistics_;
+        /// number of refinements, used to draw new samples for each of them
+        std::size_t nbRefinements_;
+    }; // class SampleDBRefiner
+  } // namespace sampling
+} // namespace rbprm
+} // namespace hpp
+
+#endif // HPP_RBPRM_SAMPLEDB_REFINER_HH
@@ -23,6 +23,7 @@
 #include <hpp/rbprm/sampling/sample.hh>
 #include <hpp/rbprm/sampling/heuristic.hh>
 #include <hpp/fcl/octree.h>
+#include <boost/cstdint.hpp>
 #include <vector>
 #include <map>
 
@@ -56,9 +57,67 @@ namespace hpp {
       }
     };
 
-    typedef std::multiset<OctreeReport, sample_compare> T_OctreeReport;
+    /// Set of contact candidates, ordered by decreasing heuristic value.
+    /// Candidates with the same value keep their insertion order.
+    /// Ordering is lazy: candidates are stored in a flat vector and only
+    /// sorted when iterated over. next() extracts them one at a time from a heap,
+    /// which is cheaper when only the first candidates are tested.
+    /// If a maximum size is set, only the maxSize best candidates are kept.
+    class HPP_RBPRM_DLLAPI CandidateSet
+    {
+    public:
+        typedef std::vector<OctreeReport> T_Reports;
+        typedef T_Reports::const_iterator const_iterator;
+
+        /// \param maxSize maximum number of candidates kept, 0 for no limit
+        explicit CandidateSet(const std::size_t maxSize = 0);
+
+        /// Adds a candidate. Restarts the extraction of next()
+        void insert(const OctreeReport& report);
+        template<typename InputIterator>
+        void insert(InputIterator first, InputIterator last)
+        {
+            for(; first != last; ++first)
+                insert(*first);
+        }
+        /// Adds all the candidates of another set, after the ones already inserted.
+        /// Restarts the extraction of next()
+        void merge(const CandidateSet& other);
+
+        /// \return the best candidate not yet returned, 0 if all candidates were returned
+        const OctreeReport* next();
+        /// Restarts the extraction of next() from the best candidate
+        void reset();
+
+        bool empty() const {return reports_.empty();}
+        std::size_t size() const;
+        std::size_t maxSize() const {return maxSize_;}
+
+        /// Iteration over all the candidates, which are sorted on the first call
+        const_iterator begin() const;
+        const_iterator end() const;
+
+    private:
+        /// only keeps the limit best candidates
+        void prune(const std::size_t limit) const;
+        /// comparison of candidates indexes, true if lhs is before rhs
+        bool before(const std::size_t lhs, const std::size_t rhs) const;
+        struct Before;
+        struct After;
+
+        std::size_t maxSize_;
+        mutable T_Reports reports_;
+        mutable bool sorted_;
+        /// indexes of the candidates not yet returned by next()
+        std::vector<std::size_t> heap_;
+        bool heapBuilt_;
+        std::size_t nbExtracted_;
+    }; // class CandidateSet
+
+    typedef CandidateSet T_OctreeReport;
 
     HPP_PREDEF_CLASS(SampleDB);
+    typedef boost::shared_ptr <const SampleDB> SampleDBPtr_t;
 
     typedef std::vector<double> T_Double;
     typedef std::map<std::string, T_Double> T_Values;
@@ -72,9 +131,17 @@ namespace hpp {
     //typedef double (*evaluate) (const SampleDB& sampleDB, const sampling::Sample& sample);
     typedef boost::function <double (const SampleDB& sampleDB, const sampling::Sample& sample) > evaluate;
     typedef std::map<std::string, evaluate> T_evaluate;
+    /// Defines an evaluation function computing several values at once for a sample,
+    /// for instance when they all depend on the same costly computation.
+    /// \param SampleDB used database with already computed values
+    /// \param sample sample candidate
+    /// \param values output values, already sized to the number of evaluated values
+    typedef boost::function <void (const SampleDB& sampleDB, const sampling::Sample& sample, T_Double& values) > evaluateBatch;
     //first sample index, number of samples
     typedef std::pair<std::size_t, std::size_t> VoxelSampleId;
     typedef std::map<long int, VoxelSampleId> T_VoxelSampleId;
+    /// voxel id, id of its ancestor in the octree
+    typedef std::map<long int, long int> T_CoarseVoxel;
     typedef std::pair<double, double> ValueBound;
     typedef std::map<std::string, ValueBound> T_ValueBound;
 
@@ -85,8 +152,27 @@ namespace hpp {
     {
     public:
          SampleDB(std::ifstream& databaseStream, bool loadValues = true);
+         /// Loads a database written with saveLimbDatabaseBinary.
+         /// The file is memory mapped, and samples, values, voxel indexes and
+         /// the octree are read from the mapped buffer without any text parsing.
+         /// The loading is not zero copy: each record is copied into a Sample allocated
+         /// on the heap, and the mapping is released once the database is built.
+         /// Compared to the text format, it saves the parsing, not the copies.
+         /// Databases saved in version 1 of the format do not contain the
+         /// octree, which is then rebuilt from the samples.
+         /// \param fileName path to the binary file
+         /// \param offset position of the database in the file (ie after a limb header)
+         /// \param loadValues whether the analysis values must be loaded
+         SampleDB(const std::string& fileName, const std::size_t offset, bool loadValues = true);
+         /// Generates a database
+         /// \param keepJacobians if false, the jacobians are dropped once the values are computed,
+         /// see DropJacobians
          SampleDB(const model::JointPtr_t limb, const std::string& effector, const std::size_t nbSamples,
-                  const fcl::Vec3f& offset= fcl::Vec3f(0,0,0), const double resolution = 0.1, const T_evaluate& data = T_evaluate(), const std::string& staticValue ="");
+                  const fcl::Vec3f& offset= fcl::Vec3f(0,0,0), const double resolution = 0.1, const T_evaluate& data = T_evaluate(), const std::string& staticValue ="",
+                  const bool keepJacobians = true);
+         /// Builds a database from existing samples, which are renumbered
+         /// \param samples samples of a same limb
+         SampleDB(const SampleVector_t& samples, const double resolution = 0.1, const T_evaluate& data = T_evaluate(), const std::string& staticValue ="");
         ~SampleDB();
 
     private:
@@ -102,6 +188,9 @@ namespace hpp {
         T_Values values_;
         T_ValueBound valueBounds_;
         T_VoxelSampleId samplesInVoxels_;
+        /// Coarser levels of the octree. coarseVoxels_[i] maps each voxel of samplesInVoxels_
+        /// to its ancestor i+1 levels up in the octree, ie a voxel 2^(i+1) times larger.
+        std::vector<T_CoarseVoxel> coarseVoxels_;
         /// fcl collision object used for collisions with environment
         fcl::CollisionObject treeObject_;
         /// Bounding boxes of areas of interest of the octree
@@ -110,9 +199,107 @@ namespace hpp {
 
     }; // class SampleDB
 
-    HPP_RBPRM_DLLAPI SampleDB& addValue(SampleDB& database, const std::string& valueName, const evaluate eval, bool isStaticValue=true, bool sortSamples=true);
+    /// Orientation index of the samples of a SampleDB, used for surface contacts.
+    /// The contact normal of the effector for each sample, expressed in the frame of the
+    /// parent joint of the limb, is quantized on nbBins directions evenly distributed on the sphere.
+    /// Each voxel of the database records the bins of its samples, so that GetCandidates can
+    /// discard the voxels and samples that are not aligned with a contact triangle.
+    /// Samples are indexed by their position in the database: the index must be
+    /// built again if the samples of the database are sorted.
+    struct HPP_RBPRM_DLLAPI OrientationBins
+    {
+        static const std::size_t nbBins = 64;
+        typedef boost::uint64_t T_BinMask;
+
+        /// Creates an empty index, which accepts all samples
+        OrientationBins();
+        /// \param database samples of the limb
+        /// \param limb root of the limb
+        /// \param effector effector joint of the limb
+        /// \param normal contact normal of the effector, expressed in the effector frame
+        OrientationBins(const SampleDB& database, const model::JointPtr_t limb, const model::JointPtr_t effector, const fcl::Vec3f& normal);
+
+        bool empty() const {return normals_.cols() == 0;}
+        /// \return the bins whose samples may be within maxAngle of a normal
+        /// \param normal unit normal, expressed in the frame of the parent joint of the limb
+        T_BinMask acceptedBins(const fcl::Vec3f& normal, const double maxAngle) const;
+        /// \return the bins of the samples of a voxel, 0 if the voxel is unknown
+        T_BinMask voxelBins(const long int voxelId) const;
+        /// \return true if the effector normal of a sample is within the angle of cosine cosMaxAngle from normal
+        bool accepts(const std::size_t sampleIndex, const fcl::Vec3f& normal, const double cosMaxAngle) const;
+
+        /// effector normal of each sample, indexed as database.samples_
+        Eigen::Matrix <model::value_type, 3, Eigen::Dynamic> normals_;
+        /// largest angle between a sample normal and the direction of its bin
+        std::vector<double> binSpread_;
+        /// bins of the samples of each voxel, one bit per bin
+        std::map<long int, T_BinMask> voxelBins_;
+    }; // struct OrientationBins
+
+    /// Evaluates a value for all the samples of a database, and stores it normalized.
+    /// \param database considered database
+    /// \param valueName name of the value
+    /// \param eval evaluation function
+    /// \param isStaticValue whether the value becomes the static value of the samples
+    /// \param sortSamples whether samples must be sorted again after the evaluation
+    /// \param parallel whether samples are evaluated in parallel. eval must then be thread safe
+    HPP_RBPRM_DLLAPI SampleDB& addValue(SampleDB& database, const std::string& valueName, const evaluate eval, bool isStaticValue=true, bool sortSamples=true,
+                                        bool parallel=false);
+
+    /// Evaluates several values for all the samples of a database in a single pass.
+    /// Existing values are not recomputed.
+    /// \param database considered database
+    /// \param valueNames names of the values, in the order they are written by eval
+    /// \param eval thread safe evaluation function
+    /// \param sortSamples whether samples must be sorted again after the evaluation
+    /// \param parallel whether samples are evaluated in parallel
+    HPP_RBPRM_DLLAPI SampleDB& addValues(SampleDB& database, const std::vector<std::string>& valueNames, const evaluateBatch eval, bool sortSamples=true,
+                                         bool parallel=true);
+
+    /// Releases the jacobians of the samples of a database, keeping the jacobian products.
+    /// The jacobians are only used to compute the analysis values: the heuristics only use
+    /// the jacobian products. Both are stored in single precision. For a 7 dof limb, a sample
+    /// takes about 470 bytes with its jacobian and 300 bytes without, against 780 bytes when
+    /// both were stored in double precision.
+    /// Jacobians can be computed again with ComputeJacobian, which AnalysisFactory::AddJacobianAnalyses
+    /// does on copies of the robot. The analyses of AnalysisFactory::evaluate_ requiring the jacobians
+    /// throw on such a database.
+    HPP_RBPRM_DLLAPI void DropJacobians(SampleDB& database);
+
+    /// \return true if the jacobians of the samples of a database are stored
+    HPP_RBPRM_DLLAPI bool HasJacobians(const SampleDB& database);
+
     HPP_RBPRM_DLLAPI bool saveLimbDatabase(const SampleDB& database, std::ofstream& dbFile);
 
+    /// Writes a database in the versioned binary format.
+    /// The layout is a fixed header followed by a packed array of samples
+    /// (id, static value, effector position, configuration, jacobian and jacobian product),
+    /// the normalized values, the voxel to sample index, the voxel bounding boxes and the octree.
+    /// A loaded database is thus ready for GetCandidates without rebuilding the octree.
+    /// The database is aligned in the file so that it can be memory mapped.
+    /// \param database the database to save
+    /// \param dbFile output stream, opened in binary mode
+    /// \return true if the database was written successfully
+    HPP_RBPRM_DLLAPI bool saveLimbDatabaseBinary(const SampleDB& database, std::ofstream& dbFile);
+
+    /// Unit normals of the triangles of a mesh, indexed as its triangles
+    typedef std::vector<Eigen::Vector3d> T_TriangleNormals;
+
+    /// Triangle normals of affordance meshes, by collision geometry
+    typedef std::map<const fcl::CollisionGeometry*, T_TriangleNormals> T_AffordanceNormals;
+    typedef boost::shared_ptr<const T_AffordanceNormals> AffordanceNormalsPtr_t;
+
+    /// \param geometry a fcl::BVHModel<fcl::OBBRSS>
+    /// \return the unit normals of the triangles of the mesh, empty if geometry is not a mesh
+    HPP_RBPRM_DLLAPI T_TriangleNormals ComputeTriangleNormals(const fcl::CollisionGeometry& geometry);
+
+    /// Computes the triangle normals of affordance objects, once per scene, so that
+    /// GetCandidates only reads them. The normals are indexed by the address of the
+    /// geometries, and must not outlive the objects.
+    /// \param objects the affordance objects
+    /// \param normals map completed with the geometries not already present
+    HPP_RBPRM_DLLAPI void AddAffordanceNormals(const model::ObjectVector_t& objects, T_AffordanceNormals& normals);
+
     /// Given the current position of a robot, returns a set
     /// of candidate sample configurations for contact generation.
     /// The set is strictly ordered using a heuristic to determine
@@ -144,6 +331,37 @@ namespace hpp {
                                             const hpp::model::CollisionObjectPtr_t& o2,
                                             const fcl::Vec3f& direction, T_OctreeReport& report, const HeuristicParam & params, const heuristic evaluate = 0);
 
+    /// Same as GetCandidates, returning at most sampleBudget samples.
+    /// Colliding voxels are grouped by their ancestor at a coarser level of the octree.
+    /// Each voxel is valued by its best remaining sample, according to evaluate
+    /// (or the static value if evaluate is null). Coarse voxels are visited by decreasing
+    /// value of their best voxel, and the best remaining sample of each coarse voxel is then
+    /// taken in turn, so that the returned samples cover all the colliding areas instead of
+    /// concentrating in the best voxel. Samples are returned once, even if their voxel
+    /// collides with several triangles.
+    /// The budget bounds the samples evaluated (one per colliding voxel, plus one per sample
+    /// returned): the collision between the octree and o2 is still computed at the finest level.
+    /// \param sampleBudget maximum number of samples returned, 0 for no limit
+    /// \param level level of the coarse voxels, between 1 and coarseVoxels_.size()
+    /// \return true if at least one candidate was found
+    HPP_RBPRM_DLLAPI bool GetCandidates(const SampleDB& sc, const fcl::Transform3f& treeTrf,
+                                            const hpp::model::CollisionObjectPtr_t& o2,
+                                            const fcl::Vec3f& direction, T_OctreeReport& report, const HeuristicParam & params,
+                                            const heuristic evaluate, const std::size_t sampleBudget, const std::size_t level = 2);
+
+    /// Same as the budgeted GetCandidates, only considering samples whose effector
+    /// normal is within maxAngle of the normal of the contacted triangle.
+    /// \param orientations orientation index of sc. If empty, all samples are considered
+    /// \param maxAngle largest angle between the effector normal and the triangle normal, in radians
+    /// \param triangleNormals normals of the triangles of o2 (see AddAffordanceNormals).
+    /// If null, the normals of the triangles in collision are computed for the request
+    HPP_RBPRM_DLLAPI bool GetCandidates(const SampleDB& sc, const fcl::Transform3f& treeTrf,
+                                            const hpp::model::CollisionObjectPtr_t& o2,
+                                            const fcl::Vec3f& direction, T_OctreeReport& report, const HeuristicParam & params,
+                                            const heuristic evaluate, const std::size_t sampleBudget, const std::size_t level,
+                                            const OrientationBins& orientations, const double maxAngle,
+                                            const T_TriangleNormals* triangleNormals = 0);
+
   } // namespace sampling
 } // namespace rbprm
 } // namespace hpp
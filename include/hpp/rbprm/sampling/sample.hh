@@ -22,6 +22,7 @@
 #include <Eigen/StdVector>
 
 #include <hpp/rbprm/config.hh>
+#include <hpp/rbprm/random.hh>
 #include <hpp/model/device.hh>
 
 #include <deque>
@@ -73,9 +74,11 @@ namespace hpp {
       model::Configuration_t configuration_;
       /// Position relative to robot root (ie, robot base at 0 everywhere)
       fcl::Vec3f effectorPosition_;
-      Eigen::MatrixXd jacobian_;
-      /// Product of the jacobian by its transpose
-      Eigen::Matrix <model::value_type, 6, 6> jacobianProduct_;
+      /// Jacobian of the effector, restricted to the limb. The jacobian and its product are
+      /// stored in single precision to reduce the memory of the databases
+      Eigen::MatrixXf jacobian_;
+      /// Product of the jacobian by its transpose, computed in double precision
+      Eigen::Matrix <float, 6, 6> jacobianProduct_;
       /// id in sample container
       std::size_t id_;
       double staticValue_;
@@ -89,13 +92,33 @@ namespace hpp {
     };
 
     typedef std::vector<Sample, Eigen::aligned_allocator<Sample> > SampleVector_t;
+
 /// Automatically generates a deque of sample configuration for a given limb of a robot
     /// \param limb root of the considered limb
     /// \param effector tag identifying the end effector of the limb
     /// \param nbSamples number of samples to be generated
     /// \param offset location of the contact point of the effector relatively to the effector joint origin
+    /// \param seed seed of the random generator. Samples are generated in parallel; for a given seed
+    /// the result does not depend on the number of threads.
     /// \return a deque of sample configurations respecting joint limits.
-SampleVector_t GenerateSamples(const model::JointPtr_t limb,  const std::string& effector,  const std::size_t nbSamples,const fcl::Vec3f& offset = fcl::Vec3f(0,0,0));
+SampleVector_t GenerateSamples(const model::JointPtr_t limb,  const std::string& effector,  const std::size_t nbSamples,const fcl::Vec3f& offset = fcl::Vec3f(0,0,0),
+                               const unsigned long long seed = 0);
+
+/// Same as JointConfiguration::uniformlySample, but drawing from a given generator
+/// instead of the global rand() state, so that it can be called from several threads.
+/// Unbounded rotations are sampled in [-pi, pi], unbounded translations are left unchanged.
+/// \param joint the joint to sample
+/// \param config the configuration in which the joint values are written
+/// \param generator the random generator to draw from
+HPP_RBPRM_DLLAPI void UniformlySample(const model::JointPtr_t joint, model::ConfigurationOut_t config, RandomGenerator& generator);
+
+/// Computes the jacobian of a sample, for databases built without their jacobians.
+/// The configuration of the robot of limb is modified.
+/// \param limb root of the limb of the sample
+/// \param effector effector joint of the limb
+/// \param sample the considered sample
+/// \return the jacobian of the effector, restricted to the limb
+Eigen::MatrixXd ComputeJacobian(const model::JointPtr_t limb, const model::JointPtr_t effector, const Sample& sample);
 
 /// Assigns the limb configuration associated with a sample to a robot configuration
 /// \param sample The limb configuration to load
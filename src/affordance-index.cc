@@ -0,0 +1,195 @@
+// Copyright (c) 2014, LAAS-CNRS
+// Authors: Steve Tonneau (steve.tonneau@laas.fr)
+//
+// This file is part of hpp-rbprm.
+// hpp-rbprm is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-rbprm is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-rbprm. If not, see <http://www.gnu.org/licenses/>.
+
+#include <hpp/rbprm/affordance-index.hh>
+#include <hpp/fcl/collision_object.h>
+
+#include <algorithm>
+
+namespace hpp {
+  namespace rbprm {
+
+    namespace
+    {
+        const std::size_t leafSize = 4;
+
+        struct CenterCompare
+        {
+            CenterCompare(const std::vector<fcl::AABB>& boxes, const int axis) : boxes_(boxes), axis_(axis) {}
+            bool operator()(const std::size_t lhs, const std::size_t rhs) const
+            {
+                const double lc = boxes_[lhs].min_[axis_] + boxes_[lhs].max_[axis_];
+                const double rc = boxes_[rhs].min_[axis_] + boxes_[rhs].max_[axis_];
+                return lc < rc || (lc == rc && lhs < rhs);
+            }
+            const std::vector<fcl::AABB>& boxes_;
+            const int axis_;
+        };
+    }
+
+    AffordanceIndexPtr_t AffordanceIndex::create (const affMap_t& affordances)
+    {
+        AffordanceIndex* ptr = new AffordanceIndex (affordances);
+        return AffordanceIndexPtr_t (ptr);
+    }
+
+    fcl::AABB AffordanceIndex::worldAABB (const fcl::CollisionGeometry& geometry, const fcl::Transform3f& transform)
+    {
+        const fcl::AABB& local = geometry.aabb_local;
+        fcl::AABB res(transform.transform(local.min_));
+        for(int i = 1; i < 8; ++i)
+        {
+            fcl::Vec3f corner((i & 1) ? local.max_[0] : local.min_[0],
+                              (i & 2) ? local.max_[1] : local.min_[1],
+                              (i & 4) ? local.max_[2] : local.min_[2]);
+            res += transform.transform(corner);
+        }
+        return res;
+    }
+
+    fcl::AABB AffordanceIndex::worldAABB (const model::CollisionObjectPtr_t& object)
+    {
+        const fcl::CollisionObjectPtr_t& obj = object->fcl();
+        return worldAABB(*obj->collisionGeometry(), obj->getTransform());
+    }
+
+    AffordanceIndex::AffordanceIndex (const affMap_t& affordances)
+    {
+        boost::shared_ptr<sampling::T_AffordanceNormals> normals(new sampling::T_AffordanceNormals);
+        for(affMap_t::const_iterator cit = affordances.begin(); cit != affordances.end(); ++cit)
+        {
+            sampling::AddAffordanceNormals(cit->second, *normals);
+            for(model::ObjectVector_t::const_iterator oit = cit->second.begin(); oit != cit->second.end(); ++oit)
+            {
+                Entry entry;
+                entry.object_ = *oit;
+                entry.type_ = types_.size();
+                entry.box_ = worldAABB(*oit);
+                entries_.push_back(entry);
+            }
+            types_.push_back(cit->first);
+        }
+        normals_ = normals;
+        for(std::vector<Entry>::const_iterator cit = entries_.begin(); cit != entries_.end(); ++cit)
+            sortedObjects_.push_back(cit->object_);
+        std::sort(sortedObjects_.begin(), sortedObjects_.end());
+        order_.resize(entries_.size());
+        for(std::size_t i = 0; i < order_.size(); ++i)
+            order_[i] = i;
+        if(!entries_.empty())
+        {
+            std::vector<fcl::AABB> boxes; boxes.reserve(entries_.size());
+            for(std::vector<Entry>::const_iterator cit = entries_.begin(); cit != entries_.end(); ++cit)
+                boxes.push_back(cit->box_);
+            nodes_.reserve(2 * entries_.size() / leafSize + 1);
+            build(boxes, 0, entries_.size());
+        }
+    }
+
+    std::size_t AffordanceIndex::build (const std::vector<fcl::AABB>& boxes, const std::size_t first, const std::size_t count)
+    {
+        const std::size_t id = nodes_.size();
+        nodes_.push_back(Node());
+        fcl::AABB box = entries_[order_[first]].box_;
+        for(std::size_t i = first + 1; i < first + count; ++i)
+            box += entries_[order_[i]].box_;
+        nodes_[id].box_ = box;
+        nodes_[id].first_ = first;
+        if(count <= leafSize)
+        {
+            nodes_[id].count_ = count;
+            return id;
+        }
+        nodes_[id].count_ = 0;
+        // median split along the largest dimension
+        int axis = 0;
+        const fcl::Vec3f extent = box.max_ - box.min_;
+        if(extent[1] > extent[axis]) axis = 1;
+        if(extent[2] > extent[axis]) axis = 2;
+        const std::size_t half = count / 2;
+        std::nth_element(order_.begin() + first, order_.begin() + first + half, order_.begin() + first + count,
+                         CenterCompare(boxes, axis));
+        const std::size_t left = build(boxes, first, half);
+        const std::size_t right = build(boxes, first + half, count - half);
+        nodes_[id].left_ = left;
+        nodes_[id].right_ = right;
+        return id;
+    }
+
+    model::ObjectVector_t AffordanceIndex::query (const fcl::AABB& box, const std::vector<std::string>& affordanceTypes) const
+    {
+        model::ObjectVector_t res;
+        if(nodes_.empty())
+            return res;
+        std::vector<bool> acceptedTypes(types_.size(), affordanceTypes.empty());
+        for(std::vector<std::string>::const_iterator cit = affordanceTypes.begin(); cit != affordanceTypes.end(); ++cit)
+        {
+            std::vector<std::string>::const_iterator tit = std::find(types_.begin(), types_.end(), *cit);
+            if(tit != types_.end())
+                acceptedTypes[tit - types_.begin()] = true;
+        }
+        std::vector<std::size_t> found;
+        std::vector<std::size_t> stack;
+        stack.push_back(0);
+        while(!stack.empty())
+        {
+            const Node& node = nodes_[stack.back()];
+            stack.pop_back();
+            if(!node.box_.overlap(box))
+                continue;
+            if(node.count_ == 0)
+            {
+                stack.push_back(node.left_);
+                stack.push_back(node.right_);
+                continue;
+            }
+            for(std::size_t i = node.first_; i < node.first_ + node.count_; ++i)
+            {
+                const Entry& entry = entries_[order_[i]];
+                if(acceptedTypes[entry.type_] && entry.box_.overlap(box))
+                    found.push_back(order_[i]);
+            }
+        }
+        std::sort(found.begin(), found.end());
+        res.reserve(found.size());
+        for(std::vector<std::size_t>::const_iterator cit = found.begin(); cit != found.end(); ++cit)
+            res.push_back(entries_[*cit].object_);
+        return res;
+    }
+
+    bool AffordanceIndex::contains (const model::CollisionObjectPtr_t& object) const
+    {
+        return std::binary_search(sortedObjects_.begin(), sortedObjects_.end(), object);
+    }
+
+    bool AffordanceIndex::indexes (const affMap_t& affordances) const
+    {
+        std::vector<Entry>::const_iterator eit = entries_.begin();
+        std::size_t type = 0;
+        for(affMap_t::const_iterator cit = affordances.begin(); cit != affordances.end(); ++cit, ++type)
+        {
+            if(type >= types_.size() || types_[type] != cit->first)
+                return false;
+            for(model::ObjectVector_t::const_iterator oit = cit->second.begin(); oit != cit->second.end(); ++oit, ++eit)
+            {
+                if(eit == entries_.end() || eit->object_ != *oit)
+                    return false;
+            }
+        }
+        return type == types_.size() && eit == entries_.end();
+    }
+  } // namespace rbprm
+} // namespace hpp
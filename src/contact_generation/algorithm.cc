@@ -155,32 +155,68 @@ ContactComputationStatus ComputeStableContact(const hpp::rbprm::RbPrmFullBodyPtr
     return rep.status_;
 }
 
+namespace
+{
+    /// ComputeContacts on a robot whose device is already in configuration,
+    /// with its forward kinematics computed
+    hpp::rbprm::State computeContactsLoaded(const hpp::rbprm::RbPrmFullBodyPtr_t& body,
+            model::ConfigurationIn_t configuration, const affMap_t& affordances,
+      const std::map<std::string, std::vector<std::string> >& affFilters, const fcl::Vec3f& direction,
+            const double robustnessTreshold, const fcl::Vec3f& acceleration)
+    {
+        const T_Limb& limbs = body->GetLimbs();
+        const rbprm::RbPrmFullBody::T_LimbGroup& limbGroups = body->GetGroups();
+        const std::map<std::string, core::CollisionValidationPtr_t>& limbcollisionValidations = body->GetLimbCollisionValidation();
+        State result;
+        result.configuration_ = configuration;
+        for(T_Limb::const_iterator lit = limbs.begin(); lit != limbs.end(); ++lit)
+        {
+            if(!ContactExistsWithinGroup(lit->second, limbGroups ,result))
+            {
+                fcl::Vec3f normal, position;
+                ComputeStableContact(body,result,
+                                    limbcollisionValidations.at(lit->first), lit->first,
+                                    lit->second, configuration, result.configuration_, affordances,affFilters,
+                                    direction, position, normal, robustnessTreshold,acceleration, false, false);
+            }
+            result.nbContacts = result.contactNormals_.size();
+        }
+        return result;
+    }
+
+    /// ComputeContacts from a previous state on a robot whose device is already in
+    /// configuration, with the position of its joints computed
+    hpp::rbprm::contact::ContactReport maintainContactsLoaded(const hpp::rbprm::State& previous,
+            const hpp::rbprm::RbPrmFullBodyPtr_t& body,
+            model::ConfigurationIn_t configuration, const affMap_t& affordances,
+            const std::map<std::string, std::vector<std::string> >& affFilters,
+            const fcl::Vec3f& direction, const double robustnessTreshold, const fcl::Vec3f& acceleration)
+    {
+        // try to maintain previous contacts
+        contact::ContactGenHelper cHelper(body,previous,configuration,affordances,affFilters,robustnessTreshold,1,1,false,
+                                          true,direction,acceleration,false,false);
+        contact::ContactReport rep = contact::oneStep(cHelper);
+
+        // copy extra dofs
+        if(rep.success_)
+        {
+            const model::size_type& extraDim = body->device_->extraConfigSpace().dimension();
+            rep.result_.configuration_.tail(extraDim) = configuration.tail(extraDim);
+        }
+        return rep;
+    }
+}
+
 hpp::rbprm::State ComputeContacts(const hpp::rbprm::RbPrmFullBodyPtr_t& body,
         model::ConfigurationIn_t configuration, const affMap_t& affordances,
   const std::map<std::string, std::vector<std::string> >& affFilters, const fcl::Vec3f& direction,
         const double robustnessTreshold, const fcl::Vec3f& acceleration)
 {
-    const T_Limb& limbs = body->GetLimbs();
-    const rbprm::RbPrmFullBody::T_LimbGroup& limbGroups = body->GetGroups();
-    const std::map<std::string, core::CollisionValidationPtr_t>& limbcollisionValidations = body->GetLimbCollisionValidation();
-    State result;
     // save old configuration
     core::ConfigurationIn_t save = body->device_->currentConfiguration();
-    result.configuration_ = configuration;
     body->device_->currentConfiguration(configuration);
     body->device_->computeForwardKinematics();
-    for(T_Limb::const_iterator lit = limbs.begin(); lit != limbs.end(); ++lit)
-    {
-        if(!ContactExistsWithinGroup(lit->second, limbGroups ,result))
-        {
-            fcl::Vec3f normal, position;
-            ComputeStableContact(body,result,
-                                limbcollisionValidations.at(lit->first), lit->first,
-                                lit->second, configuration, result.configuration_, affordances,affFilters,
-                                direction, position, normal, robustnessTreshold,acceleration, false, false);
-        }
-        result.nbContacts = result.contactNormals_.size();
-    }
+    State result = computeContactsLoaded(body, configuration, affordances, affFilters, direction, robustnessTreshold, acceleration);
     // reload previous configuration
     body->device_->currentConfiguration(save);
     return result;
@@ -200,22 +236,41 @@ hpp::rbprm::contact::ContactReport ComputeContacts(const hpp::rbprm::State& prev
     body->device_->controlComputation (newflag);
     body->device_->currentConfiguration(configuration);
     body->device_->computeForwardKinematics ();
-    // try to maintain previous contacts
-    contact::ContactGenHelper cHelper(body,previous,configuration,affordances,affFilters,robustnessTreshold,1,1,false,
-                                      true,direction,acceleration,false,false);
-    contact::ContactReport rep = contact::oneStep(cHelper);
-
-    // copy extra dofs
-    if(rep.success_)
-    {
-        const model::size_type& extraDim = body->device_->extraConfigSpace().dimension();
-        rep.result_.configuration_.tail(extraDim) = configuration.tail(extraDim);
-    }
+    contact::ContactReport rep = maintainContactsLoaded(previous, body, configuration, affordances, affFilters,
+                                                        direction, robustnessTreshold, acceleration);
     body->device_->currentConfiguration(save);
     body->device_->controlComputation (flag);
     return rep;
 }
 
+hpp::rbprm::State ComputeContacts(KinematicsWorkspace& workspace,
+        model::ConfigurationIn_t configuration, const affMap_t& affordances,
+  const std::map<std::string, std::vector<std::string> >& affFilters, const fcl::Vec3f& direction,
+        const double robustnessTreshold, const fcl::Vec3f& acceleration)
+{
+    // the forward kinematics are only computed if the workspace is not in configuration yet
+    workspace.configuration(configuration);
+    return computeContactsLoaded(workspace.fullBody(), configuration, affordances, affFilters, direction, robustnessTreshold, acceleration);
+}
+
+hpp::rbprm::contact::ContactReport ComputeContacts(const hpp::rbprm::State& previous,
+        KinematicsWorkspace& workspace,
+        model::ConfigurationIn_t configuration, const affMap_t& affordances,
+        const std::map<std::string, std::vector<std::string> >& affFilters,
+        const fcl::Vec3f& direction, const double robustnessTreshold, const fcl::Vec3f& acceleration)
+{
+    // the complete forward kinematics of the workspace are kept, so that they can be reused by
+    // the other overload: only the computations of the contact generation are restricted
+    workspace.configuration(configuration);
+    const model::DevicePtr_t& device = workspace.fullBody()->device_;
+    model::Device::Computation_t flag = device->computationFlag ();
+    device->controlComputation (static_cast <model::Device::Computation_t> (model::Device::JOINT_POSITION));
+    contact::ContactReport rep = maintainContactsLoaded(previous, workspace.fullBody(), configuration, affordances, affFilters,
+                                                        direction, robustnessTreshold, acceleration);
+    device->controlComputation (flag);
+    return rep;
+}
+
 } // namespace projection
 } // namespace rbprm
 } // namespace hpp
@@ -17,8 +17,14 @@
 // <http://www.gnu.org/licenses/>.
 
 #include <hpp/rbprm/contact_generation/contact_generation.hh>
+#include <hpp/rbprm/contact_generation/work-stealing.hh>
 #include <hpp/rbprm/stability/stability.hh>
 #include <hpp/rbprm/tools.hh>
+#include <hpp/rbprm/random.hh>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <omp.h>
 #ifdef PROFILE
     #include "hpp/rbprm/rbprm-profiler.hh"
 #endif
@@ -52,9 +58,19 @@ ContactGenHelper::ContactGenHelper(RbPrmFullBodyPtr_t fb, const State& ps, model
 , affFilters_(affFilters)
 , workingState_(previousState_)
 , checkStabilityGenerate_(checkStabilityGenerate)
+, maxCandidates_(0)
+, sampleBudget_(0)
+, coarseLevel_(2)
+, maxOrientationAngle_(M_PI)
+, speculativeCandidates_(0)
+, combinatorialWorkers_(0)
 {
     workingState_.configuration_ = configuration;
     workingState_.stable = false;
+    // the index and the triangle normals are built once per scene
+    affordanceIndex_ = fb->affordanceIndex(affordances);
+    if(affordanceIndex_)
+        affordanceNormals_ = affordanceIndex_->normals();
 }
 
 typedef std::vector<T_State > T_DepthState;
@@ -306,6 +322,84 @@ T_ContactState gen_contacts_combinatorial(ContactGenHelper& contactGenHelper)
 }
 
 
+namespace
+{
+    typedef std::vector<boost::shared_ptr<ContactGenHelper> > T_Helpers;
+
+    /// copies of a helper working on the workers of its robot, see RbPrmFullBody::workers
+    T_Helpers workerHelpers(const ContactGenHelper &contactGenHelper)
+    {
+        const std::size_t nbWorkers = contactGenHelper.combinatorialWorkers_;
+        const std::vector<RbPrmFullBodyPtr_t>& workers = contactGenHelper.fullBody_->workers(nbWorkers);
+        T_Helpers res;
+        for(std::size_t i = 0; i < nbWorkers; ++i)
+        {
+            boost::shared_ptr<ContactGenHelper> helper(new ContactGenHelper(contactGenHelper));
+            helper->fullBody_ = workers[i];
+            // workers already run in parallel
+            helper->speculativeCandidates_ = 0;
+            helper->combinatorialWorkers_ = 0;
+            res.push_back(helper);
+        }
+        return res;
+    }
+
+    /// the robot is left in the configuration of the selected state, as by the sequential search
+    void loadResult(const ContactGenHelper &contactGenHelper, const ProjectionReport& rep)
+    {
+        if(!rep.success_)
+            return;
+        model::DevicePtr_t device = contactGenHelper.fullBody_->device_;
+        device->currentConfiguration(rep.result_.configuration_);
+        device->computeForwardKinematics();
+    }
+
+    /// task of maintain_contacts: projection of a candidate state of maintain_contacts_combinatorial
+    struct MaintainTask
+    {
+        MaintainTask(const std::vector<State>& candidates, const T_Helpers& helpers)
+            : candidates_(candidates), helpers_(helpers), reports_(candidates.size()) {}
+
+        bool operator()(const std::size_t task, const std::size_t worker)
+        {
+            ContactGenHelper& helper = *helpers_[worker];
+            ProjectionReport rep = projectToRootConfiguration(helper.fullBody_,helper.workingState_.configuration_,candidates_[task]);
+            if(rep.success_)
+                rep = genColFree(helper, rep);
+            if(rep.success_)
+            {
+                hpp::core::ValidationReportPtr_t valRep (new hpp::core::CollisionValidationReport);
+                rep.success_ = helper.fullBody_->GetCollisionValidation()->validate(rep.result_.configuration_, valRep);
+            }
+            reports_[task] = rep;
+            return rep.success_;
+        }
+
+        const std::vector<State>& candidates_;
+        const T_Helpers& helpers_;
+        std::vector<ProjectionReport> reports_;
+    };
+}
+
+ProjectionReport maintain_contacts_parallel(ContactGenHelper &contactGenHelper)
+{
+    Q_State& candidates = contactGenHelper.candidates_;
+    std::vector<State> states;
+    for(; !candidates.empty(); candidates.pop())
+        states.push_back(candidates.front());
+    const T_Helpers helpers = workerHelpers(contactGenHelper);
+    MaintainTask task(states, helpers);
+    const std::size_t first = findFirstSuccess(task, states.size(), helpers.size());
+    // the candidates after the selected one are left for the next calls
+    for(std::size_t i = first + 1; i < states.size(); ++i)
+        candidates.push(states[i]);
+    if(states.empty())
+        return ProjectionReport();
+    const ProjectionReport& rep = first < states.size() ? task.reports_[first] : task.reports_.back();
+    loadResult(contactGenHelper, rep);
+    return rep;
+}
+
 ProjectionReport maintain_contacts(ContactGenHelper &contactGenHelper)
 {
     ProjectionReport rep;
@@ -314,6 +408,8 @@ ProjectionReport maintain_contacts(ContactGenHelper &contactGenHelper)
         candidates = maintain_contacts_combinatorial(contactGenHelper.workingState_,contactGenHelper.maxContactBreaks_);
     else
         candidates.pop(); // first candidate already treated.
+    if(contactGenHelper.combinatorialWorkers_ > 1)
+        rep = maintain_contacts_parallel(contactGenHelper);
     while(!candidates.empty() && !rep.success_)
     {
         //retrieve latest state
@@ -335,55 +431,291 @@ ProjectionReport maintain_contacts(ContactGenHelper &contactGenHelper)
 }
 
 
+namespace
+{
+    boost::uint64_t mix(const boost::uint64_t seed, const boost::uint64_t value)
+    {
+        return (seed ^ value) * 0x100000001B3ULL;
+    }
+
+    /// seed of the random generators of a contact query. It only depends on the global seed,
+    /// the limb and the location of its octree, so that a query draws the same values
+    /// whatever the thread running it and the queries run before
+    boost::uint64_t querySeed(const std::string& limbName, const fcl::Transform3f& transform)
+    {
+        boost::uint64_t seed = RandomSeed();
+        for(std::string::const_iterator cit = limbName.begin(); cit != limbName.end(); ++cit)
+            seed = mix(seed, (boost::uint64_t)(unsigned char)(*cit));
+        for(int i = 0; i < 3; ++i)
+        {
+            const double value = transform.getTranslation()[i];
+            boost::uint64_t bits;
+            std::memcpy(&bits, &value, sizeof(double));
+            seed = mix(seed, bits);
+        }
+        return seed;
+    }
+}
+
 sampling::T_OctreeReport CollideOctree(const ContactGenHelper &contactGenHelper, const std::string& limbName,
-                                                    RbPrmLimbPtr_t limb, const sampling::heuristic evaluate, const sampling::HeuristicParam & params)
+                                                    RbPrmLimbPtr_t limb, const sampling::SampleDB& database, const sampling::OrientationBins& orientations,
+                                                    const sampling::heuristic evaluate, const sampling::HeuristicParam & params)
 {
     fcl::Transform3f transform = limb->octreeRoot(); // get root transform from configuration
     hpp::model::ObjectVector_t affordances = getAffObjectsForLimb (limbName,contactGenHelper.affordances_, contactGenHelper.affFilters_);
 
-    //#pragma omp parallel for
     // request samples which collide with each of the collision objects
     sampling::heuristic eval =  evaluate == 0 ? limb->evaluate_ : evaluate;
-    std::size_t i (0);
     if (affordances.empty ())
       throw std::runtime_error ("No aff objects found!!!");
 
-    std::vector<sampling::T_OctreeReport> reports(affordances.size());
-    for(model::ObjectVector_t::const_iterator oit = affordances.begin();
-        oit != affordances.end(); ++oit, ++i)
+    // only affordances overlapping the octree are requested
+    const fcl::AABB octreeBox = AffordanceIndex::worldAABB(*database.geometry_, transform);
+    model::ObjectVector_t candidates;
+    if(contactGenHelper.affordanceIndex_)
+    {
+        model::ObjectVector_t nearby = contactGenHelper.affordanceIndex_->query(octreeBox);
+        std::sort(nearby.begin(), nearby.end());
+        for(model::ObjectVector_t::const_iterator oit = affordances.begin(); oit != affordances.end(); ++oit)
+        {
+            if(std::binary_search(nearby.begin(), nearby.end(), *oit))
+                candidates.push_back(*oit);
+        }
+    }
+    else
+    {
+        for(model::ObjectVector_t::const_iterator oit = affordances.begin(); oit != affordances.end(); ++oit)
+        {
+            if(AffordanceIndex::worldAABB(*oit).overlap(octreeBox))
+                candidates.push_back(*oit);
+        }
+    }
+
+    // each affordance fills its own set, sets are merged in the order of the affordances
+    // so that the result does not depend on the scheduling
+    const long nbCandidates = (long)candidates.size();
+    const std::size_t maxCandidates = contactGenHelper.maxCandidates_ > 0 ? contactGenHelper.maxCandidates_ : contactGenHelper.sampleBudget_;
+    std::vector<sampling::T_OctreeReport> reports(candidates.size(), sampling::T_OctreeReport(maxCandidates));
+    std::vector<const sampling::T_TriangleNormals*> normals(candidates.size(), 0);
+    for(std::size_t i = 0; contactGenHelper.affordanceNormals_ && i < candidates.size(); ++i)
+    {
+        sampling::T_AffordanceNormals::const_iterator nit = contactGenHelper.affordanceNormals_->find(
+                    candidates[i]->fcl()->collisionGeometry().get());
+        if(nit != contactGenHelper.affordanceNormals_->end())
+            normals[i] = &nit->second;
+    }
+    // each affordance draws from its own random stream
+    const boost::uint64_t seed = querySeed(limbName, transform);
+    #pragma omp parallel for schedule(dynamic)
+    for(long i = 0; i < nbCandidates; ++i)
     {
-        if(eval)
-            sampling::GetCandidates(limb->sampleContainer_, transform, *oit, contactGenHelper.direction_, reports[i], params, eval);
-        else
-            sampling::GetCandidates(limb->sampleContainer_, transform, *oit, contactGenHelper.direction_, reports[i], params);
+        RandomGenerator generator;
+        generator.seed(seed, (boost::uint64_t)i);
+        sampling::HeuristicParam taskParams(params);
+        taskParams.generator_ = &generator;
+        sampling::GetCandidates(database, transform, candidates[i], contactGenHelper.direction_, reports[i], taskParams, eval,
+                                contactGenHelper.sampleBudget_, contactGenHelper.coarseLevel_,
+                                orientations, contactGenHelper.maxOrientationAngle_, normals[i]);
     }
-    sampling::T_OctreeReport finalSet;
+    sampling::T_OctreeReport finalSet(maxCandidates);
     // order samples according to EFORT
     for(std::vector<sampling::T_OctreeReport>::const_iterator cit = reports.begin();
         cit != reports.end(); ++cit)
     {
-        finalSet.insert(cit->begin(), cit->end());
+        finalSet.merge(*cit);
     }
     return finalSet;
 }
 
+namespace
+{
+    /// result of the projection of a contact candidate by a worker
+    struct CandidateEvaluation
+    {
+        CandidateEvaluation() : projected_(false), accepted_(false), robustness_(0) {}
+        bool projected_;
+        /// whether the candidate satisfies the stability requirements
+        bool accepted_;
+        double robustness_;
+        core::Configuration_t configuration_;
+        fcl::Vec3f position_, normal_;
+        fcl::Matrix3f rotation_;
+    };
+
+    /// \return whether a candidate ranked before index was accepted, in which case the evaluation
+    /// of index is discarded. firstAccepted is written under the same critical section
+    bool superseded(const std::size_t index, const std::size_t& firstAccepted)
+    {
+        bool res;
+        #pragma omp critical (speculativeCandidates)
+        {
+            res = index > firstAccepted;
+        }
+        return res;
+    }
+
+    /// \param index rank of the candidate in the order of the heuristic
+    /// \param firstAccepted rank of the first accepted candidate, shared by the workers
+    void evaluateCandidate(const ContactGenHelper &contactGenHelper, const RbPrmFullBodyPtr_t& worker, const std::string& limbId,
+                           const sampling::OctreeReport& report, const State& current, const std::size_t index,
+                           const std::size_t& firstAccepted, CandidateEvaluation& evaluation)
+    {
+        RbPrmLimbPtr_t limb = worker->GetLimbs().at(limbId);
+        core::CollisionValidationPtr_t validation = worker->GetLimbCollisionValidation().at(limbId);
+        evaluation.configuration_ = current.configuration_;
+        worker->device_->currentConfiguration(current.configuration_);
+        worker->device_->computeForwardKinematics();
+        ProjectionReport rep = projectSampleToObstacle(worker, limbId, limb, report, validation, evaluation.configuration_, current);
+        // the stability of the candidate is not computed if a better one was accepted meanwhile
+        if(!rep.success_ || superseded(index, firstAccepted))
+            return;
+        evaluation.projected_ = true;
+        evaluation.robustness_ = stability::IsStable(worker, rep.result_, contactGenHelper.acceleration_);
+        evaluation.accepted_ =  !contactGenHelper.checkStabilityGenerate_
+                             || (rep.result_.nbContacts == 1 && !contactGenHelper.stableForOneContact_)
+                             || evaluation.robustness_ >= contactGenHelper.robustnessTreshold_;
+        evaluation.position_ = limb->effector_->currentTransformation().getTranslation();
+        evaluation.rotation_ = limb->effector_->currentTransformation().getRotation();
+        evaluation.normal_ = rep.result_.contactNormals_.at(limbId);
+    }
+
+    /// Projects the candidates of finalSet in parallel, on the workers of the robot.
+    /// Candidates are handed to the workers in the order of the heuristic. Once a candidate
+    /// is accepted, the candidates ranked after it are not started anymore, those already
+    /// projected are not checked for stability, and their results are discarded. The candidates ranked before it are all
+    /// evaluated, so the selected candidate is the one the sequential search would select.
+    /// \return the evaluations of the candidates, in the order of the heuristic
+    std::vector<CandidateEvaluation> evaluateCandidates(const ContactGenHelper &contactGenHelper, const std::string& limbId,
+                                                        sampling::T_OctreeReport& finalSet, const State& current,
+                                                        std::vector<const sampling::OctreeReport*>& candidates)
+    {
+        const std::vector<RbPrmFullBodyPtr_t>& workers = contactGenHelper.fullBody_->workers(contactGenHelper.speculativeCandidates_);
+        const int nbWorkers = (int)contactGenHelper.speculativeCandidates_;
+        std::vector<CandidateEvaluation> evaluations;
+        std::size_t firstAccepted = std::numeric_limits<std::size_t>::max();
+        bool exhausted = false;
+        #pragma omp parallel num_threads(nbWorkers)
+        {
+            const RbPrmFullBodyPtr_t& worker = workers[omp_get_thread_num()];
+            CandidateEvaluation evaluation;
+            for(;;)
+            {
+                const sampling::OctreeReport* report = 0;
+                std::size_t index = 0;
+                #pragma omp critical (speculativeCandidates)
+                {
+                    if(!exhausted && candidates.size() < firstAccepted)
+                    {
+                        report = finalSet.next();
+                        exhausted = (report == 0);
+                        if(report)
+                        {
+                            index = candidates.size();
+                            candidates.push_back(report);
+                            evaluations.push_back(CandidateEvaluation());
+                        }
+                    }
+                }
+                if(!report)
+                    break;
+                evaluation = CandidateEvaluation();
+                evaluateCandidate(contactGenHelper, worker, limbId, *report, current, index, firstAccepted, evaluation);
+                #pragma omp critical (speculativeCandidates)
+                {
+                    evaluations[index] = evaluation;
+                    if(evaluation.accepted_ && index < firstAccepted)
+                        firstAccepted = index;
+                }
+            }
+        }
+        return evaluations;
+    }
+}
+
+hpp::rbprm::State findValidCandidateSpeculative(const ContactGenHelper &contactGenHelper, const std::string& limbId,
+                        RbPrmLimbPtr_t limb, sampling::T_OctreeReport& finalSet, bool& found_sample, bool& unstableContact)
+{
+    State current = contactGenHelper.workingState_;
+    current.stable = false;
+    std::vector<const sampling::OctreeReport*> candidates;
+    const std::vector<CandidateEvaluation> evaluations = evaluateCandidates(contactGenHelper, limbId, finalSet, current, candidates);
+    // the evaluations are read in the order of the heuristic, as the sequential search does
+    const CandidateEvaluation* selected = 0;
+    double maxRob = -std::numeric_limits<double>::max();
+    for(std::size_t i = 0; i < evaluations.size() && !found_sample; ++i)
+    {
+        const CandidateEvaluation& evaluation = evaluations[i];
+        if(limb->refiner_)
+            limb->refiner_->recordHit(*candidates[i]->sample_);
+        if(!evaluation.projected_)
+            continue;
+        if(evaluation.accepted_)
+        {
+            selected = &evaluation;
+            found_sample = true;
+            unstableContact = false;
+            if(limb->refiner_)
+                limb->refiner_->recordSuccess(*candidates[i]->sample_);
+        }
+        else if((evaluation.robustness_ > maxRob) && contactGenHelper.contactIfFails_)
+        {
+            selected = &evaluation;
+            maxRob = evaluation.robustness_;
+            unstableContact = true;
+        }
+    }
+    if(selected)
+    {
+        current.contacts_[limbId] = true;
+        current.contactNormals_[limbId] = selected->normal_;
+        current.contactPositions_[limbId] = selected->position_;
+        current.contactRotation_[limbId] = selected->rotation_;
+        current.contactOrder_.push(limbId);
+        current.configuration_ = selected->configuration_;
+        current.stable = found_sample;
+    }
+    // the robot is left in the selected configuration, as by the sequential search
+    model::DevicePtr_t device = contactGenHelper.fullBody_->device_;
+    device->currentConfiguration(current.configuration_);
+    device->computeForwardKinematics();
+    return current;
+}
+
+namespace
+{
+    /// accepts all the samples
+    const sampling::OrientationBins noOrientationBins;
+}
+
 hpp::rbprm::State findValidCandidate(const ContactGenHelper &contactGenHelper, const std::string& limbId,
                         RbPrmLimbPtr_t limb, core::CollisionValidationPtr_t validation, bool& found_sample,
                                      bool& unstableContact, const sampling::HeuristicParam & params, const sampling::heuristic evaluate = 0)
 {
     State current = contactGenHelper.workingState_;
     current.stable = false;
-    sampling::T_OctreeReport finalSet = CollideOctree(contactGenHelper, limbId, limb, evaluate, params);
+    // the refined database in use is kept alive as long as its samples are
+    const sampling::RefinedSampleDBPtr_t refined = limb->refiner_ ? limb->refiner_->current() : sampling::RefinedSampleDBPtr_t();
+    const sampling::SampleDB& database = refined ? refined->database_ : limb->sampleContainer_;
+    // the orientation index of the limb is only built once the filter is enabled
+    const sampling::OrientationBins& orientations = refined ? refined->orientationBins_
+                                                  : contactGenHelper.maxOrientationAngle_ < M_PI ? limb->orientationBins()
+                                                  : noOrientationBins;
+    sampling::T_OctreeReport finalSet = CollideOctree(contactGenHelper, limbId, limb, database, orientations, evaluate, params);
+    if(contactGenHelper.speculativeCandidates_ > 1)
+        return findValidCandidateSpeculative(contactGenHelper, limbId, limb, finalSet, found_sample, unstableContact);
     core::Configuration_t moreRobust, configuration;
     configuration = current.configuration_;
     double maxRob = -std::numeric_limits<double>::max();
-    sampling::T_OctreeReport::const_iterator it = finalSet.begin();
     fcl::Vec3f position, normal;
     fcl::Matrix3f rotation;
     ProjectionReport rep ;
-    for(;!found_sample && it!=finalSet.end(); ++it)
+    const sampling::OctreeReport* it;
+    // candidates are extracted by decreasing heuristic value, only as long as needed
+    while(!found_sample && (it = finalSet.next()))
     {
         const sampling::OctreeReport& bestReport = *it;
+        if(limb->refiner_)
+            limb->refiner_->recordHit(*bestReport.sample_);
         /*ProjectionReport */rep = projectSampleToObstacle(contactGenHelper.fullBody_, limbId, limb, bestReport, validation, configuration, current);
         if(rep.success_)
         {
@@ -397,6 +729,8 @@ hpp::rbprm::State findValidCandidate(const ContactGenHelper &contactGenHelper, c
                 rotation = limb->effector_->currentTransformation().getRotation();
                 normal = rep.result_.contactNormals_.at(limbId);
                 found_sample = true;
+                if(limb->refiner_)
+                    limb->refiner_->recordSuccess(*bestReport.sample_);
             }
             // if no stable candidate is found, select best contact
             // anyway
@@ -445,7 +779,11 @@ ProjectionReport generate_contact(const ContactGenHelper &contactGenHelper, cons
     // pick first sample which is collision free
     bool found_sample(false);
     bool unstableContact(false); //set to true in case no stable contact is found
-    rep.result_ = findValidCandidate(contactGenHelper,limbName,limb, validation, found_sample,unstableContact, params, evaluate);
+    // the data the heuristics derive from the parameters is computed once for all the candidates
+    sampling::HeuristicParam queryParams(params);
+    if(!queryParams.context_)
+        queryParams.prepare();
+    rep.result_ = findValidCandidate(contactGenHelper,limbName,limb, validation, found_sample,unstableContact, queryParams, evaluate);
     if(found_sample)
     {
         rep.status_ = STABLE_CONTACT;
@@ -477,51 +815,117 @@ ProjectionReport generate_contact(const ContactGenHelper &contactGenHelper, cons
     return rep;
 }
 
+/// tries to create the contacts of a candidate of gen_contacts_combinatorial
+void gen_contacts_state(ContactGenHelper &contactGenHelper, const ContactState& cState, ProjectionReport& rep)
+{
+    bool checkStability(contactGenHelper.checkStabilityGenerate_);
+    contactGenHelper.checkStabilityGenerate_ = false; // stability not mandatory before last contact is created
+    if(cState.second.empty() && contactGenHelper.workingState_.stable)
+    {
+        if(contactGenHelper.workingState_.nbContacts > 2)
+        {
+            rep.result_ = contactGenHelper.workingState_;
+            rep.status_ = NO_CONTACT;
+            rep.success_ = true;
+            return;
+        }
+    }
+    for(std::vector<std::string>::const_iterator cit = cState.second.begin();
+        cit != cState.second.end(); ++cit)
+    {
+
+        sampling::HeuristicParam params;
+        params.contactPositions_ = cState.first.contactPositions_;
+        contactGenHelper.fullBody_->device_->computeForwardKinematics();
+        params.comPosition_ = contactGenHelper.fullBody_->device_->positionCenterOfMass();
+        int cfgSize(cState.first.configuration_.rows());
+        params.comSpeed_ = fcl::Vec3f(cState.first.configuration_[cfgSize-6], cState.first.configuration_[cfgSize-5], cState.first.configuration_[cfgSize-4]);
+        params.comAcceleration_ = contactGenHelper.acceleration_;
+        params.sampleLimbName_ = *cit;
+        params.tfWorldRoot_ = contactGenHelper.fullBody_->device_->rootJoint()->currentTransformation();
+
+        if(cit+1 == cState.second.end())
+            contactGenHelper.checkStabilityGenerate_ = checkStability;
+        rep = generate_contact(contactGenHelper,*cit, params);
+        if(rep.success_)
+        {
+            contactGenHelper.workingState_ = rep.result_;
+        }
+        //else
+        //    break;
+    }
+}
+
+namespace
+{
+    /// task of gen_contacts: contact creation for a candidate of gen_contacts_combinatorial.
+    /// Each candidate starts from the working state of the helper.
+    struct GenTask
+    {
+        GenTask(const std::vector<ContactState>& candidates, const std::vector<bool>& checkStability, const T_Helpers& helpers)
+            : candidates_(candidates), checkStability_(checkStability), helpers_(helpers)
+            , reports_(candidates.size()), workingStates_(candidates.size()) {}
+
+        bool operator()(const std::size_t task, const std::size_t worker)
+        {
+            ContactGenHelper helper(*helpers_[worker]);
+            helper.checkStabilityGenerate_ = checkStability_[task];
+            // gen_contacts_state reads the center of mass and root transform from the device,
+            // which holds the configuration of the previous task of the worker
+            helper.fullBody_->device_->currentConfiguration(helper.workingState_.configuration_);
+            helper.fullBody_->device_->computeForwardKinematics();
+            gen_contacts_state(helper, candidates_[task], reports_[task]);
+            workingStates_[task] = helper.workingState_;
+            return reports_[task].success_;
+        }
+
+        const std::vector<ContactState>& candidates_;
+        const std::vector<bool>& checkStability_;
+        const T_Helpers& helpers_;
+        std::vector<ProjectionReport> reports_;
+        std::vector<State> workingStates_;
+    };
+}
+
+ProjectionReport gen_contacts_parallel(ContactGenHelper &contactGenHelper, T_ContactState& candidates)
+{
+    std::vector<ContactState> states;
+    for(; !candidates.empty(); candidates.pop())
+        states.push_back(candidates.front());
+    if(states.empty())
+        return ProjectionReport();
+    // the sequential search disables the stability check after a candidate without contact creation
+    std::vector<bool> checkStability;
+    bool check = contactGenHelper.checkStabilityGenerate_;
+    for(std::vector<ContactState>::const_iterator cit = states.begin(); cit != states.end(); ++cit)
+    {
+        checkStability.push_back(check);
+        if(cit->second.empty())
+            check = false;
+    }
+    const T_Helpers helpers = workerHelpers(contactGenHelper);
+    GenTask task(states, checkStability, helpers);
+    std::size_t selected = findFirstSuccess(task, states.size(), helpers.size());
+    if(selected == states.size())
+        --selected;
+    contactGenHelper.workingState_ = task.workingStates_[selected];
+    contactGenHelper.checkStabilityGenerate_ = states[selected].second.empty() ? false : checkStability[selected];
+    loadResult(contactGenHelper, task.reports_[selected]);
+    return task.reports_[selected];
+}
+
 ProjectionReport gen_contacts(ContactGenHelper &contactGenHelper)
 {
     ProjectionReport rep;
     T_ContactState candidates = gen_contacts_combinatorial(contactGenHelper);
+    if(contactGenHelper.combinatorialWorkers_ > 1)
+        return gen_contacts_parallel(contactGenHelper, candidates);
     while(!candidates.empty() && !rep.success_)
     {
         //retrieve latest state
         ContactState cState = candidates.front();
         candidates.pop();
-        bool checkStability(contactGenHelper.checkStabilityGenerate_);
-        contactGenHelper.checkStabilityGenerate_ = false; // stability not mandatory before last contact is created
-        if(cState.second.empty() && contactGenHelper.workingState_.stable)
-        {
-            if(contactGenHelper.workingState_.nbContacts > 2)
-            {
-                rep.result_ = contactGenHelper.workingState_;
-                rep.status_ = NO_CONTACT;
-                rep.success_ = true;
-                return rep;
-            }
-        }
-        for(std::vector<std::string>::const_iterator cit = cState.second.begin();
-            cit != cState.second.end(); ++cit)
-        {
-
-            sampling::HeuristicParam params;
-            params.contactPositions_ = cState.first.contactPositions_;
-            contactGenHelper.fullBody_->device_->computeForwardKinematics();
-            params.comPosition_ = contactGenHelper.fullBody_->device_->positionCenterOfMass();
-            int cfgSize(cState.first.configuration_.rows());
-            params.comSpeed_ = fcl::Vec3f(cState.first.configuration_[cfgSize-6], cState.first.configuration_[cfgSize-5], cState.first.configuration_[cfgSize-4]);
-            params.comAcceleration_ = contactGenHelper.acceleration_;
-            params.sampleLimbName_ = *cit;
-            params.tfWorldRoot_ = contactGenHelper.fullBody_->device_->rootJoint()->currentTransformation();
-
-            if(cit+1 == cState.second.end())
-                contactGenHelper.checkStabilityGenerate_ = checkStability;
-            rep = generate_contact(contactGenHelper,*cit, params);
-            if(rep.success_)
-            {
-                contactGenHelper.workingState_ = rep.result_;
-            }
-            //else
-            //    break;
-        }
+        gen_contacts_state(contactGenHelper, cState, rep);
     }
     return rep;
 }
@@ -0,0 +1,135 @@
+// Copyright (c) 2014, LAAS-CNRS
+// Authors: Steve Tonneau (steve.tonneau@laas.fr)
+//
+// This file is part of hpp-rbprm.
+// hpp-rbprm is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-rbprm is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-rbprm. If not, see <http://www.gnu.org/licenses/>.
+
+#include <hpp/rbprm/interpolation/contact-cache.hh>
+#include <hpp/rbprm/projection/projection.hh>
+#include <hpp/rbprm/stability/stability.hh>
+
+#include <cmath>
+#include <queue>
+#include <stdexcept>
+
+namespace hpp {
+  namespace rbprm {
+  namespace interpolation {
+
+    ContactCachePtr_t ContactCache::create (const RbPrmFullBodyPtr_t& fullBody, const double positionResolution,
+                                            const double orientationResolution, const std::size_t maxSize)
+    {
+        return ContactCachePtr_t(new ContactCache(fullBody, positionResolution, orientationResolution, maxSize));
+    }
+
+    ContactCache::ContactCache (const RbPrmFullBodyPtr_t& fullBody, const double positionResolution,
+                                const double orientationResolution, const std::size_t maxSize)
+        : positionResolution_(positionResolution)
+        , orientationResolution_(orientationResolution)
+        , maxSize_(maxSize)
+        , fullBody_(fullBody)
+        , hits_(0)
+        , misses_(0)
+    {
+        if(positionResolution <= 0 || orientationResolution <= 0)
+            throw std::runtime_error ("Contact cache resolutions must be positive");
+    }
+
+    bool ContactCache::Key::operator< (const Key& other) const
+    {
+        if(cells_ != other.cells_)
+            return cells_ < other.cells_;
+        if(contacts_ != other.contacts_)
+            return contacts_ < other.contacts_;
+        return values_ < other.values_;
+    }
+
+    ContactCache::Key ContactCache::key (const State& previous, model::ConfigurationIn_t configuration,
+                                         const double robustnessTreshold) const
+    {
+        Key res;
+        std::queue<std::string> order = previous.contactOrder_;
+        for(; !order.empty(); order.pop())
+        {
+            const std::string& name = order.front();
+            res.contacts_.push_back(name);
+            std::map<std::string, fcl::Vec3f>::const_iterator cit = previous.contactPositions_.find(name);
+            if(cit != previous.contactPositions_.end())
+                for(int i = 0; i < 3; ++i)
+                    res.values_.push_back(cit->second[i]);
+        }
+        res.values_.push_back(robustnessTreshold);
+        for(int i = 0; i < 3; ++i)
+            res.cells_.push_back((long)std::floor(configuration[i] / positionResolution_));
+        // q and -q are the same orientation
+        const double sign = configuration[3] < 0 ? -1 : 1;
+        for(int i = 3; i < 7; ++i)
+            res.cells_.push_back((long)std::floor(sign * configuration[i] / orientationResolution_));
+        return res;
+    }
+
+    const contact::ContactReport* ContactCache::find (const State& previous, model::ConfigurationIn_t configuration,
+                                                      const double robustnessTreshold) const
+    {
+        std::map<Key, contact::ContactReport>::const_iterator cit = reports_.find(key(previous, configuration, robustnessTreshold));
+        return cit == reports_.end() ? 0 : &cit->second;
+    }
+
+    void ContactCache::insert (const State& previous, model::ConfigurationIn_t configuration, const double robustnessTreshold,
+                               const contact::ContactReport& report)
+    {
+        if(reports_.size() >= maxSize_)
+            reports_.clear();
+        reports_[key(previous, configuration, robustnessTreshold)] = report;
+    }
+
+    void ContactCache::clear ()
+    {
+        reports_.clear();
+        hits_ = 0;
+        misses_ = 0;
+    }
+
+    bool ContactCache::get (const State& previous, model::ConfigurationIn_t configuration, const double robustnessTreshold,
+                            const fcl::Vec3f& acceleration, contact::ContactReport& report)
+    {
+        const contact::ContactReport* cached = find(previous, configuration, robustnessTreshold);
+        if(!cached || !cached->success_)
+        {
+            ++misses_;
+            return false;
+        }
+        projection::ProjectionReport rep = projection::projectToRootConfiguration(fullBody_, configuration, cached->result_);
+        if(rep.success_)
+        {
+            hpp::core::ValidationReportPtr_t valRep (new hpp::core::CollisionValidationReport);
+            rep.success_ = fullBody_->GetCollisionValidation()->validate(rep.result_.configuration_, valRep);
+        }
+        if(rep.success_ && cached->result_.stable)
+            rep.success_ = stability::IsStable(fullBody_, rep.result_, acceleration) >= robustnessTreshold;
+        if(!rep.success_)
+        {
+            ++misses_;
+            return false;
+        }
+        report = *cached;
+        report.result_ = rep.result_;
+        // extra dofs are copied, as by ComputeContacts
+        const model::size_type& extraDim = fullBody_->device_->extraConfigSpace().dimension();
+        report.result_.configuration_.tail(extraDim) = configuration.tail(extraDim);
+        ++hits_;
+        return true;
+    }
+  } // namespace interpolation
+  } // namespace rbprm
+} // namespace hpp
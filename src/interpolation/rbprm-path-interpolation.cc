@@ -106,8 +106,14 @@ namespace hpp {
             direction.normalize(&nonZero);
             if(!nonZero) direction = fcl::Vec3f(0,0,1.);
             // TODO Direction 6d
-            hpp::rbprm::contact::ContactReport rep = contact::ComputeContacts(previous, robot_,configuration, affordances,affFilters,direction,
-                                             robustnessTreshold,acc);
+            hpp::rbprm::contact::ContactReport rep;
+            if(!contactCache_ || !contactCache_->get(previous, configuration, robustnessTreshold, acc, rep))
+            {
+                rep = contact::ComputeContacts(previous, robot_,configuration, affordances,affFilters,direction,
+                                               robustnessTreshold,acc);
+                if(contactCache_)
+                    contactCache_->insert(previous, configuration, robustnessTreshold, rep);
+            }
             State& newState = rep.result_;
 
 
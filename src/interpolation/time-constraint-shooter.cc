@@ -17,6 +17,7 @@
 #include <hpp/rbprm/interpolation/com-rrt-shooter.hh>
 #include <hpp/rbprm/interpolation/time-constraint-utils.hh>
 #include <hpp/rbprm/rbprm-limb.hh>
+#include <hpp/rbprm/random.hh>
 #include <hpp/rbprm/sampling/sample.hh>
 #include <hpp/model/joint.hh>
 #include <hpp/model/joint-configuration.hh>
@@ -67,7 +68,8 @@ using namespace core;
     {
         // edit path sampling dof
         value_type a = rootPath_->timeRange().first; value_type b = rootPath_->timeRange().second;
-        value_type u = value_type(rand()) / value_type(RAND_MAX);
+        RandomGenerator& generator = ThreadRandom();
+        value_type u = generator.uniform();
         value_type pathDofVal = (b-a)* u + a;
         ConfigurationPtr_t config (new Configuration_t(configSize_));
         config->head(configSize_-1) =  (*rootPath_)(pathDofVal);
@@ -87,7 +89,7 @@ using namespace core;
             for(rbprm::CIT_Limb cit = freeLimbs_.begin(); cit != freeLimbs_.end(); ++cit)
             {
                 const rbprm::RbPrmLimbPtr_t limb = cit->second;
-                const int rand_int = (rand() % (int) (limb->sampleContainer_.samples_.size() -1));
+                const std::size_t rand_int = generator.index(limb->sampleContainer_.samples_.size() -1);
                 const sampling::Sample& sample = *(limb->sampleContainer_.samples_.begin() + rand_int);
                 sampling::Load(sample,*config);
             }
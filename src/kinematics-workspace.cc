@@ -0,0 +1,45 @@
+// Copyright (c) 2014, LAAS-CNRS
+// Authors: Steve Tonneau (steve.tonneau@laas.fr)
+//
+// This file is part of hpp-rbprm.
+// hpp-rbprm is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-rbprm is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-rbprm. If not, see <http://www.gnu.org/licenses/>.
+
+#include <hpp/rbprm/kinematics-workspace.hh>
+
+namespace hpp {
+  namespace rbprm {
+
+    KinematicsWorkspacePtr_t KinematicsWorkspace::create (const RbPrmFullBody& fullBody)
+    {
+        return KinematicsWorkspacePtr_t(new KinematicsWorkspace(fullBody));
+    }
+
+    KinematicsWorkspace::KinematicsWorkspace (const RbPrmFullBody& fullBody)
+        : fullBody_(fullBody.clone())
+    {
+        configuration(fullBody_->device_->currentConfiguration());
+    }
+
+    void KinematicsWorkspace::configuration (model::ConfigurationIn_t configuration)
+    {
+        const model::DevicePtr_t& device = fullBody_->device_;
+        // contact generation may have moved the device since the last call
+        if(configuration_.size() == configuration.size() && configuration_ == configuration
+                && device->currentConfiguration() == configuration_)
+            return;
+        configuration_ = configuration;
+        device->currentConfiguration(configuration_);
+        device->computeForwardKinematics();
+    }
+  } // rbprm
+} //hpp
@@ -29,6 +29,7 @@
 #include <hpp/core/path-projector.hh>
 #include <hpp/core/kinodynamic-oriented-path.hh>
 #include <hpp/rbprm/planner/rbprm-node.hh>
+#include <hpp/rbprm/random.hh>
 #include <hpp/core/path-validation.hh>
 #include <hpp/core/config-validations.hh>
 #include <hpp/util/timer.hh>
@@ -148,8 +149,8 @@ namespace hpp{
       while (!finished && projectionError != 0) {
         t[0] = tmpPath->timeRange ().first;
         t[3] = tmpPath->timeRange ().second;
-        value_type u2 = t[0] + (t[3] -t[0]) * rand ()/RAND_MAX;
-        value_type u1 = t[0] + (t[3] -t[0]) * rand ()/RAND_MAX;
+        value_type u2 = t[0] + (t[3] -t[0]) * ThreadRandom().uniform();
+        value_type u1 = t[0] + (t[3] -t[0]) * ThreadRandom().uniform();
         if (u1 < u2) {t[1] = u1; t[2] = u2;} else {t[1] = u2; t[2] = u1;}
         if (!(*tmpPath) (q[1], t[1])) {
           hppDout (error, "Configuration at param " << t[1] << " could not be "
@@ -30,6 +30,7 @@
 # include <hpp/rbprm/rbprm-device.hh>
 # include <hpp/rbprm/rbprm-path-validation.hh>
 # include <hpp/rbprm/rbprm-validation-report.hh>
+# include <hpp/rbprm/random.hh>
 
 namespace hpp {
   namespace rbprm {
@@ -394,8 +395,8 @@ namespace hpp {
       if(alpha_1_minus_ < 0 )
         alpha_1_minus_ = 0; //otherwise we go in the wrong direction
       value_type interval = (alpha_1_plus_-alpha_1_minus_)/2.;  // according to friction cone computed in compute_3d_path
-      value_type alpha = (((value_type) rand()/RAND_MAX) * interval) + alpha_1_minus_;
-      value_type v = (((value_type) rand()/RAND_MAX) * V0max_);
+      value_type alpha = (ThreadRandom().uniform() * interval) + alpha_1_minus_;
+      value_type v = (ThreadRandom().uniform() * V0max_);
       *alpha0 = alpha;
       *v0 = v;
       hppDout(notice,"Compute random path :");
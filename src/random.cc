@@ -0,0 +1,125 @@
+// Copyright (c) 2014, LAAS-CNRS
+// Authors: Steve Tonneau (steve.tonneau@laas.fr)
+//
+// This file is part of hpp-rbprm.
+// hpp-rbprm is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-rbprm is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-rbprm. If not, see <http://www.gnu.org/licenses/>.
+
+#include <hpp/rbprm/random.hh>
+#include <omp.h>
+
+namespace hpp {
+  namespace rbprm {
+    namespace
+    {
+        boost::uint64_t rotl(const boost::uint64_t x, const int k)
+        {
+            return (x << k) | (x >> (64 - k));
+        }
+
+        boost::uint64_t splitmix64(boost::uint64_t& state)
+        {
+            boost::uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            return z ^ (z >> 31);
+        }
+
+        boost::uint64_t globalSeed = 0;
+        /// incremented by SeedRandom, so that the threads reseed their generator lazily
+        boost::uint64_t globalGeneration = 1;
+
+        /// generator of a thread. Zero initialized, hence generation_ differs from
+        /// globalGeneration on first use
+        struct ThreadGenerator
+        {
+            RandomGenerator generator_;
+            boost::uint64_t generation_;
+        };
+        ThreadGenerator threadGenerator;
+        #pragma omp threadprivate(threadGenerator)
+
+        /// stream of the calling thread, given by its thread number in each of the
+        /// enclosing teams, so that the threads of nested teams draw from distinct streams
+        boost::uint64_t threadStream()
+        {
+            boost::uint64_t stream = 0;
+            for(int level = 1; level <= omp_get_level(); ++level)
+                stream = stream * 0x100000001B3ULL + (boost::uint64_t)omp_get_ancestor_thread_num(level) + 1;
+            return stream;
+        }
+    }
+
+    void RandomGenerator::seed(const boost::uint64_t seed, const boost::uint64_t stream)
+    {
+        boost::uint64_t state = seed ^ (0xD1B54A32D192ED03ULL * (stream + 1));
+        for(int i = 0; i < 4; ++i)
+            state_[i] = splitmix64(state);
+    }
+
+    boost::uint64_t RandomGenerator::next()
+    {
+        const boost::uint64_t result = rotl(state_[1] * 5, 7) * 9;
+        const boost::uint64_t t = state_[1] << 17;
+        state_[2] ^= state_[0];
+        state_[3] ^= state_[1];
+        state_[1] ^= state_[2];
+        state_[0] ^= state_[3];
+        state_[2] ^= t;
+        state_[3] = rotl(state_[3], 45);
+        return result;
+    }
+
+    double RandomGenerator::uniform()
+    {
+        return (double)(next() >> 11) * (1. / 9007199254740992.);
+    }
+
+    double RandomGenerator::uniform(const double min, const double max)
+    {
+        return min + (max - min) * uniform();
+    }
+
+    std::size_t RandomGenerator::index(const std::size_t n)
+    {
+        const std::size_t res = (std::size_t)(uniform() * (double)n);
+        return res < n ? res : n - 1;
+    }
+
+    std::ptrdiff_t RandomGenerator::operator()(const std::ptrdiff_t n)
+    {
+        return (std::ptrdiff_t)index((std::size_t)n);
+    }
+
+    void SeedRandom(const boost::uint64_t seed)
+    {
+        globalSeed = seed;
+        ++globalGeneration;
+    }
+
+    boost::uint64_t RandomSeed()
+    {
+        return globalSeed;
+    }
+
+    RandomGenerator& ThreadRandom()
+    {
+        ThreadGenerator& local = threadGenerator;
+        if(local.generation_ != globalGeneration)
+        {
+            local.generator_.seed(globalSeed, threadStream());
+            local.generation_ = globalGeneration;
+        }
+        return local.generator_;
+    }
+  } // namespace rbprm
+} // namespace hpp
@@ -37,6 +37,20 @@ namespace hpp {
         return res;
     }
 
+    RbPrmDevicePtr_t RbPrmDevice::createCopy (const RbPrmDevicePtr_t& device)
+    {
+        hpp::model::T_Rom roms;
+        for(hpp::model::T_Rom::const_iterator cit = device->robotRoms_.begin();
+            cit != device->robotRoms_.end(); ++cit)
+        {
+            roms.insert(std::make_pair(cit->first, cit->second->clone()));
+        }
+        RbPrmDevice* rbprmDevice = new RbPrmDevice(*device, roms);
+        RbPrmDevicePtr_t res (rbprmDevice);
+        res->initCopy (res, *device);
+        return res;
+    }
+
     RbPrmDevice::~RbPrmDevice()
     {
         // NOTHING
@@ -50,6 +64,12 @@ namespace hpp {
         weakPtr_ = weakPtr;
     }
 
+    void RbPrmDevice::initCopy(const RbPrmDeviceWkPtr_t& weakPtr, const RbPrmDevice& model)
+    {
+        Device::initCopy (weakPtr, model);
+        weakPtr_ = weakPtr;
+    }
+
     bool RbPrmDevice::currentConfiguration (ConfigurationIn_t configuration)
     {
         for(hpp::model::T_Rom::const_iterator cit = robotRoms_.begin();
@@ -77,5 +97,13 @@ namespace hpp {
     {
         // NOTHING
     }
+
+    RbPrmDevice::RbPrmDevice (const RbPrmDevice& device, const hpp::model::T_Rom &robotRoms)
+        : Device(device)
+        , robotRoms_(robotRoms)
+        , weakPtr_()
+    {
+        // NOTHING
+    }
   } // model
 } //hpp
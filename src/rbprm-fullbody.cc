@@ -16,6 +16,7 @@
 
 #include <hpp/rbprm/rbprm-fullbody.hh>
 #include <hpp/model/joint.hh>
+#include <hpp/model/body.hh>
 #include <hpp/rbprm/tools.hh>
 #include <hpp/rbprm/stability/stability.hh>
 #include <hpp/rbprm/ik-solver.hh>
@@ -44,6 +45,71 @@ namespace hpp {
 
     const double epsilon = 10e-3;
 
+    namespace
+    {
+        /// gives access to the state of a collision validation
+        struct CollisionValidationAccess : public core::CollisionValidation
+        {
+            static core::CollisionPairs_t& pairs(core::CollisionValidation& validation)
+            {
+                return validation.*(&CollisionValidationAccess::collisionPairs_);
+            }
+
+            static const core::CollisionPairs_t& pairs(const core::CollisionValidation& validation)
+            {
+                return validation.*(&CollisionValidationAccess::collisionPairs_);
+            }
+
+            static fcl::CollisionRequest& request(core::CollisionValidation& validation)
+            {
+                return validation.*(&CollisionValidationAccess::collisionRequest_);
+            }
+
+            static const fcl::CollisionRequest& request(const core::CollisionValidation& validation)
+            {
+                return validation.*(&CollisionValidationAccess::collisionRequest_);
+            }
+        };
+
+        typedef std::map<model::CollisionObjectPtr_t, model::CollisionObjectPtr_t> T_ObjectCopies;
+
+        /// \return the object of device corresponding to an object of the copied robot,
+        /// or object itself if it is an obstacle
+        model::CollisionObjectPtr_t copyObject(const model::CollisionObjectPtr_t& object, const model::DevicePtr_t& device,
+                                               T_ObjectCopies& copies)
+        {
+            const model::JointPtr_t joint = object->joint();
+            if(!joint)
+                return object;
+            T_ObjectCopies::const_iterator cit = copies.find(object);
+            if(cit != copies.end())
+                return cit->second;
+            const model::ObjectVector_t& objects = device->getJointByName(joint->name())->linkedBody()->innerObjects(model::COLLISION);
+            for(model::ObjectVector_t::const_iterator oit = objects.begin(); oit != objects.end(); ++oit)
+            {
+                if((*oit)->name() == object->name())
+                {
+                    copies.insert(std::make_pair(object, *oit));
+                    return *oit;
+                }
+            }
+            throw std::runtime_error ("Impossible to copy collision validation: no object " + object->name() + " in joint " + joint->name());
+        }
+
+        /// Copies the collision pairs of a validation of another robot
+        /// \param device device of validation, copy of the device of from
+        void copyValidation(const core::CollisionValidation& from, core::CollisionValidation& validation,
+                            const model::DevicePtr_t& device, T_ObjectCopies& copies)
+        {
+            core::CollisionPairs_t& pairs = CollisionValidationAccess::pairs(validation);
+            pairs.clear();
+            const core::CollisionPairs_t& fromPairs = CollisionValidationAccess::pairs(from);
+            for(core::CollisionPairs_t::const_iterator cit = fromPairs.begin(); cit != fromPairs.end(); ++cit)
+                pairs.push_back(core::CollisionPair_t(copyObject(cit->first, device, copies), copyObject(cit->second, device, copies)));
+            CollisionValidationAccess::request(validation) = CollisionValidationAccess::request(from);
+        }
+    }
+
     RbPrmFullBodyPtr_t RbPrmFullBody::create (const model::DevicePtr_t &device)
     {
         RbPrmFullBody* fullBody = new RbPrmFullBody(device);
@@ -52,6 +118,25 @@ namespace hpp {
         return res;
     }
 
+    RbPrmFullBodyPtr_t RbPrmFullBody::createCopy (const RbPrmFullBody& fullBody, const model::DevicePtr_t& device)
+    {
+        RbPrmFullBody* copy = new RbPrmFullBody(fullBody, device);
+        RbPrmFullBodyPtr_t res (copy);
+        res->init (res);
+        return res;
+    }
+
+    RbPrmFullBodyPtr_t RbPrmFullBody::clone () const
+    {
+        model::DevicePtr_t device;
+        // the robot may be copied by several threads
+        #pragma omp critical (fullBodyClone)
+        {
+            device = device_->clone();
+        }
+        return createCopy(*this, device);
+    }
+
     RbPrmFullBody::~RbPrmFullBody()
     {
         // NOTHING
@@ -84,6 +169,8 @@ namespace hpp {
             }
         }
         limbs_.insert(std::make_pair(id, limb));
+        limbObstacles_.push_back(std::make_pair(id, collisionObjects));
+        workers_.clear();
         tools::RemoveNonLimbCollisionRec<core::CollisionValidation>(device_->rootJoint(),name,collisionObjects,*limbcollisionValidation_.get());
         hpp::core::RelativeMotion::matrix_type m = hpp::core::RelativeMotion::matrix(device_);
         limbcollisionValidation_->filterCollisionPairs(m);
@@ -103,6 +190,65 @@ namespace hpp {
         }
     }
 
+    AffordanceIndexPtr_t RbPrmFullBody::affordanceIndex(const affMap_t& affordances)
+    {
+        AffordanceIndexPtr_t res;
+        #pragma omp critical (fullBodyAffordanceIndex)
+        {
+            if(!affordanceIndex_ || !affordanceIndex_->indexes(affordances))
+                affordanceIndex_ = AffordanceIndex::create(affordances);
+            res = affordanceIndex_;
+        }
+        return res;
+    }
+
+    void RbPrmFullBody::affordanceIndex(const AffordanceIndexPtr_t& affordanceIndex)
+    {
+        #pragma omp critical (fullBodyAffordanceIndex)
+        {
+            affordanceIndex_ = affordanceIndex;
+        }
+    }
+
+    const std::vector<RbPrmFullBodyPtr_t>& RbPrmFullBody::workers(const std::size_t nbWorkers)
+    {
+        // workers copied the validations when they were created
+        bool pairsChanged = CollisionValidationAccess::pairs(*collisionValidation_) != workersPairs_[""];
+        for(std::map<std::string, core::CollisionValidationPtr_t>::const_iterator cit = limbcollisionValidations_.begin();
+            cit != limbcollisionValidations_.end() && !pairsChanged; ++cit)
+        {
+            pairsChanged = CollisionValidationAccess::pairs(*cit->second) != workersPairs_[cit->first];
+        }
+        if(pairsChanged)
+        {
+            workers_.clear();
+            workersPairs_.clear();
+            workersPairs_.insert(std::make_pair(std::string(), CollisionValidationAccess::pairs(*collisionValidation_)));
+            for(std::map<std::string, core::CollisionValidationPtr_t>::const_iterator cit = limbcollisionValidations_.begin();
+                cit != limbcollisionValidations_.end(); ++cit)
+                workersPairs_.insert(std::make_pair(cit->first, CollisionValidationAccess::pairs(*cit->second)));
+        }
+        while(workers_.size() < nbWorkers)
+        {
+            workers_.push_back(clone());
+        }
+        for(std::vector<RbPrmFullBodyPtr_t>::iterator it = workers_.begin(); it != workers_.end(); ++it)
+        {
+            RbPrmFullBody& worker = **it;
+            worker.affordanceIndex_ = affordanceIndex_;
+            worker.staticStability_ = staticStability_;
+            worker.mu_ = mu_;
+            worker.referenceConfig_ = referenceConfig_;
+            for(T_Limb::const_iterator cit = limbs_.begin(); cit != limbs_.end(); ++cit)
+            {
+                const RbPrmLimbPtr_t& limb = worker.limbs_.at(cit->first);
+                limb->evaluate_ = cit->second->evaluate_;
+                limb->refiner_ = cit->second->refiner_;
+            }
+        }
+        return workers_;
+    }
+
     std::map<std::string, const sampling::heuristic>::const_iterator checkLimbData(const std::string& id, const rbprm::T_Limb& limbs, const rbprm::sampling::HeuristicFactory& factory, const std::string& heuristicName)
     {
         rbprm::T_Limb::const_iterator cit = limbs.find(id);
@@ -120,11 +266,12 @@ namespace hpp {
                                 const fcl::Vec3f &offset,const fcl::Vec3f &normal, const double x,
                                 const double y,
                                 const model::ObjectVector_t &collisionObjects, const std::size_t nbSamples, const std::string &heuristicName, const double resolution,
-                                ContactType contactType, const bool disableEffectorCollision,  const bool grasp)
+                                ContactType contactType, const bool disableEffectorCollision,  const bool grasp, const bool keepJacobians)
     {
         std::map<std::string, const sampling::heuristic>::const_iterator hit = checkLimbData(id, limbs_,factory_,heuristicName);
         model::JointPtr_t joint = device_->getJointByName(name);
-        rbprm::RbPrmLimbPtr_t limb = rbprm::RbPrmLimb::create(joint, effectorName, offset,normal,x,y, nbSamples, hit->second, resolution,contactType, disableEffectorCollision, grasp);
+        rbprm::RbPrmLimbPtr_t limb = rbprm::RbPrmLimb::create(joint, effectorName, offset,normal,x,y, nbSamples, hit->second, resolution,contactType,
+                                                              disableEffectorCollision, grasp, keepJacobians);
         AddLimbPrivate(limb, id, name,collisionObjects, disableEffectorCollision);
     }
 
@@ -135,10 +282,14 @@ namespace hpp {
                                 const bool grasp)
     {
         std::map<std::string, const sampling::heuristic>::const_iterator hit = checkLimbData(id, limbs_,factory_,heuristicName);;
-        std::ifstream myfile (database.c_str());
+        std::ifstream myfile (database.c_str(), std::ios::in | std::ios::binary);
         if (!myfile.good())
             throw std::runtime_error ("Impossible to open database");
-        rbprm::RbPrmLimbPtr_t limb = rbprm::RbPrmLimb::create(device_, myfile, loadValues, hit->second, disableEffectorCollision, grasp);
+        rbprm::RbPrmLimbPtr_t limb;
+        if(rbprm::isBinaryLimbDatabase(myfile))
+            limb = rbprm::RbPrmLimb::create(device_, myfile, database, loadValues, hit->second, disableEffectorCollision, grasp);
+        else
+            limb = rbprm::RbPrmLimb::create(device_, myfile, loadValues, hit->second, disableEffectorCollision, grasp);
         myfile.close();
         AddLimbPrivate(limb, id, limb->limb_->name(),collisionObjects, disableEffectorCollision);
     }
@@ -157,5 +308,32 @@ namespace hpp {
     {
         // NOTHING
     }
+
+    RbPrmFullBody::RbPrmFullBody (const RbPrmFullBody& fullBody, const model::DevicePtr_t& device)
+        : device_(device)
+        , collisionValidation_(core::CollisionValidation::create(device))
+        , factory_(fullBody.factory_)
+        , staticStability_(fullBody.staticStability_)
+        , mu_(fullBody.mu_)
+        , referenceConfig_(fullBody.referenceConfig_)
+        , affordanceIndex_(fullBody.affordanceIndex_)
+        , weakPtr_()
+    {
+        // limbs are added again in the same order, then the validations take the pairs of
+        // those of fullBody, which may have been modified after AddLimb
+        for(std::vector<std::pair<std::string, model::ObjectVector_t> >::const_iterator cit = fullBody.limbObstacles_.begin();
+            cit != fullBody.limbObstacles_.end(); ++cit)
+        {
+            const RbPrmLimbPtr_t limb = RbPrmLimb::createCopy(fullBody.limbs_.at(cit->first), device);
+            AddLimbPrivate(limb, cit->first, limb->limb_->name(), cit->second, limb->disableEndEffectorCollision_);
+        }
+        T_ObjectCopies copies;
+        copyValidation(*fullBody.collisionValidation_, *collisionValidation_, device, copies);
+        for(std::map<std::string, core::CollisionValidationPtr_t>::const_iterator cit = fullBody.limbcollisionValidations_.begin();
+            cit != fullBody.limbcollisionValidations_.end(); ++cit)
+        {
+            copyValidation(*cit->second, *limbcollisionValidations_.at(cit->first), device, copies);
+        }
+    }
   } // rbprm
 } //hpp
@@ -25,10 +25,11 @@ namespace hpp {
     RbPrmLimbPtr_t RbPrmLimb::create (const model::JointPtr_t limb, const std::string& effectorName, const fcl::Vec3f &offset,
                                       const fcl::Vec3f &normal,const double x, const double y,
                                       const std::size_t nbSamples, const hpp::rbprm::sampling::heuristic evaluate, const double resolution,
-                                      hpp::rbprm::ContactType contactType, const bool disableEffectorCollision, const bool grasp)
+                                      hpp::rbprm::ContactType contactType, const bool disableEffectorCollision, const bool grasp,
+                                      const bool keepJacobians)
     {
         RbPrmLimb* rbprmDevice = new RbPrmLimb(limb, effectorName, offset, normal, x, y, nbSamples,evaluate,
-                                               resolution, contactType, disableEffectorCollision, grasp);
+                                               resolution, contactType, disableEffectorCollision, grasp, keepJacobians);
         RbPrmLimbPtr_t res (rbprmDevice);
         res->init (res);
         return res;
@@ -43,6 +44,24 @@ namespace hpp {
         return res;
     }
 
+    RbPrmLimbPtr_t RbPrmLimb::create (const model::DevicePtr_t device, std::ifstream& fileStream, const std::string& fileName,
+                                      const bool loadValues, const hpp::rbprm::sampling::heuristic evaluate,
+                                      const bool disableEffectorCollision, const bool grasp)
+    {
+        RbPrmLimb* rbprmDevice = new RbPrmLimb(device, fileStream, fileName, loadValues, evaluate, disableEffectorCollision, grasp);
+        RbPrmLimbPtr_t res (rbprmDevice);
+        res->init (res);
+        return res;
+    }
+
+    RbPrmLimbPtr_t RbPrmLimb::createCopy (const RbPrmLimbPtr_t& limb, const model::DevicePtr_t& device)
+    {
+        RbPrmLimb* rbprmDevice = new RbPrmLimb(*limb, device);
+        RbPrmLimbPtr_t res (rbprmDevice);
+        res->init (res);
+        return res;
+    }
+
     RbPrmLimb::~RbPrmLimb()
     {
         // NOTHING
@@ -76,10 +95,18 @@ namespace hpp {
         return rot.transpose();
     }
 
+    boost::shared_ptr<const sampling::OrientationBins> BuildOrientationBins(const sampling::SampleDB& database, const model::JointPtr_t limb,
+                                                   const model::JointPtr_t effector, const fcl::Vec3f& normal, const ContactType contactType)
+    {
+        if(contactType == _6_DOF)
+            return boost::shared_ptr<const sampling::OrientationBins>(new sampling::OrientationBins(database, limb, effector, normal));
+        return boost::shared_ptr<const sampling::OrientationBins>(new sampling::OrientationBins());
+    }
+
     RbPrmLimb::RbPrmLimb (const model::JointPtr_t& limb, const std::string& effectorName,
                           const fcl::Vec3f &offset, const fcl::Vec3f &normal, const double x, const double y, const std::size_t nbSamples,
                           const hpp::rbprm::sampling::heuristic evaluate, const double resolution, ContactType contactType,
-                          bool disableEndEffectorCollision, bool grasps)
+                          bool disableEndEffectorCollision, bool grasps, const bool keepJacobians)
         : limb_(limb)
         , effector_(GetEffector(limb, effectorName))
         , effectorDefaultRotation_(GetEffectorTransform(effector_))
@@ -90,29 +117,133 @@ namespace hpp {
         , y_(y)
         , contactType_(contactType)
         , evaluate_(evaluate)
-        , sampleContainer_(limb, effector_->name(), nbSamples, offset, resolution)
+        , database_(new sampling::SampleDB(limb, effector_->name(), nbSamples, offset, resolution,
+                                           sampling::T_evaluate(), "", keepJacobians))
+        , sampleContainer_(*database_)
+        , orientations_(new boost::shared_ptr<const sampling::OrientationBins>)
         , disableEndEffectorCollision_(disableEndEffectorCollision)
         , grasps_(grasps)
     {
         // NOTHING
     }
 
+    RbPrmLimb::RbPrmLimb (const RbPrmLimb& limb, const model::DevicePtr_t& device)
+        : limb_(device->getJointByName(limb.limb_->name()))
+        , effector_(device->getJointByName(limb.effector_->name()))
+        , effectorDefaultRotation_(limb.effectorDefaultRotation_)
+        , offset_(limb.offset_)
+        , normal_(limb.normal_)
+        , x_(limb.x_)
+        , y_(limb.y_)
+        , contactType_(limb.contactType_)
+        , evaluate_(limb.evaluate_)
+        , database_(limb.database_)
+        , sampleContainer_(*database_)
+        , orientations_(limb.orientations_)
+        , refiner_(limb.refiner_)
+        , disableEndEffectorCollision_(limb.disableEndEffectorCollision_)
+        , grasps_(limb.grasps_)
+    {
+        // NOTHING
+    }
+
     fcl::Transform3f RbPrmLimb::octreeRoot() const
     {
         return limb_->parentJoint()->currentTransformation();
     }
 
+    const sampling::OrientationBins& RbPrmLimb::orientationBins() const
+    {
+        const sampling::OrientationBins* res;
+        #pragma omp critical (limbOrientationBins)
+        {
+            if(!*orientations_)
+                *orientations_ = BuildOrientationBins(sampleContainer_, limb_, effector_, normal_, contactType_);
+            res = orientations_->get();
+        }
+        return *res;
+    }
+
+    void RbPrmLimb::enableRefinement(const sampling::T_evaluate& data, const std::string& staticValue)
+    {
+        // the samples were generated with the offset given at the creation of the limb
+        const fcl::Vec3f offset = effectorDefaultRotation_.transpose() * offset_;
+        refiner_ = sampling::SampleDBRefiner::create(database_, limb_, effector_, offset, normal_, contactType_ == _6_DOF,
+                                                     data, staticValue);
+    }
+
+    namespace
+    {
+        const std::string binaryLimbDatabaseTag("RBPRM_BINARY_LIMB_DATABASE");
+        // number of lines written by writeLimbInfo
+        const std::size_t nbLimbInfoLines = 8;
+
+        void writeLimbInfo(const hpp::rbprm::RbPrmLimbPtr_t limb, std::ofstream& fp)
+        {
+            fp << limb->limb_->name() << std::endl;
+            fp << limb->effector_->name() << std::endl;
+            tools::io::writeRotMatrixFCL(limb->effectorDefaultRotation_, fp); fp << std::endl;
+            tools::io::writeVecFCL(limb->offset_, fp); fp << std::endl;
+            tools::io::writeVecFCL(limb->normal_, fp); fp << std::endl;
+            fp << limb->x_ << std::endl;
+            fp << limb->y_ << std::endl;
+            fp << (int)limb->contactType_ << std::endl;
+        }
+    }
+
+    // the last refined database is saved if the limb is being refined
     bool saveLimbInfoAndDatabase(const hpp::rbprm::RbPrmLimbPtr_t limb, std::ofstream& fp)
     {
-        fp << limb->limb_->name() << std::endl;
-        fp << limb->effector_->name() << std::endl;
-        tools::io::writeRotMatrixFCL(limb->effectorDefaultRotation_, fp); fp << std::endl;
-        tools::io::writeVecFCL(limb->offset_, fp); fp << std::endl;
-        tools::io::writeVecFCL(limb->normal_, fp); fp << std::endl;
-        fp << limb->x_ << std::endl;
-        fp << limb->y_ << std::endl;
-        fp << (int)limb->contactType_ << std::endl;
-        return sampling::saveLimbDatabase(limb->sampleContainer_,fp);
+        writeLimbInfo(limb, fp);
+        const sampling::RefinedSampleDBPtr_t refined = limb->refiner_ ? limb->refiner_->current() : sampling::RefinedSampleDBPtr_t();
+        return sampling::saveLimbDatabase(refined ? refined->database_ : limb->sampleContainer_,fp);
+    }
+
+    bool saveLimbInfoAndDatabaseBinary(const hpp::rbprm::RbPrmLimbPtr_t limb, std::ofstream& fp)
+    {
+        fp << binaryLimbDatabaseTag << std::endl;
+        writeLimbInfo(limb, fp);
+        const sampling::RefinedSampleDBPtr_t refined = limb->refiner_ ? limb->refiner_->current() : sampling::RefinedSampleDBPtr_t();
+        return sampling::saveLimbDatabaseBinary(refined ? refined->database_ : limb->sampleContainer_,fp);
+    }
+
+    bool isBinaryLimbDatabase(std::ifstream& fp)
+    {
+        std::string line;
+        getline(fp, line);
+        if(line == binaryLimbDatabaseTag)
+            return true;
+        fp.clear();
+        fp.seekg(0, std::ios::beg);
+        return false;
+    }
+
+    bool convertLimbDatabase(const std::string& textDatabase, const std::string& binaryDatabase)
+    {
+        std::ifstream input (textDatabase.c_str());
+        if (!input.good())
+            throw std::runtime_error ("Impossible to open database " + textDatabase);
+        if(isBinaryLimbDatabase(input))
+            throw std::runtime_error ("Database is already in binary format " + textDatabase);
+        // limb information is copied as is, since it does not depend on the robot
+        std::vector<std::string> limbInfo;
+        std::string line;
+        for(std::size_t i = 0; i < nbLimbInfoLines; ++i)
+        {
+            getline(input, line);
+            limbInfo.push_back(line);
+        }
+        const sampling::SampleDB database(input, true);
+        input.close();
+        std::ofstream output (binaryDatabase.c_str(), std::ios::out | std::ios::binary);
+        if (!output.good())
+            throw std::runtime_error ("Impossible to create database " + binaryDatabase);
+        output << binaryLimbDatabaseTag << std::endl;
+        for(std::vector<std::string>::const_iterator cit = limbInfo.begin(); cit != limbInfo.end(); ++cit)
+            output << *cit << std::endl;
+        bool res = sampling::saveLimbDatabaseBinary(database, output);
+        output.close();
+        return res;
     }
   } // rbprm
 
@@ -150,7 +281,30 @@ namespace hpp {
       , y_(StrToD(fileStream))
       , contactType_(static_cast<hpp::rbprm::ContactType>(StrToI(fileStream)))
       , evaluate_(evaluate)
-      , sampleContainer_(fileStream, loadValues)
+      , database_(new sampling::SampleDB(fileStream, loadValues))
+      , sampleContainer_(*database_)
+      , orientations_(new boost::shared_ptr<const sampling::OrientationBins>)
+      , disableEndEffectorCollision_(disableEndEffectorCollision)
+      , grasps_(grasps)
+    {
+      // NOTHING
+    }
+
+    hpp::rbprm::RbPrmLimb::RbPrmLimb (const model::DevicePtr_t device, std::ifstream& fileStream, const std::string& fileName,
+                        const bool loadValues, const hpp::rbprm::sampling::heuristic evaluate,
+                        bool disableEndEffectorCollision, bool grasps)
+      : limb_(extractJoint(device,fileStream))
+      , effector_(extractJoint(device,fileStream))
+      , effectorDefaultRotation_(tools::io::readRotMatrixFCL(fileStream))
+      , offset_(readVecFCL(fileStream))
+      , normal_(readVecFCL(fileStream))
+      , x_(StrToD(fileStream))
+      , y_(StrToD(fileStream))
+      , contactType_(static_cast<hpp::rbprm::ContactType>(StrToI(fileStream)))
+      , evaluate_(evaluate)
+      , database_(new sampling::SampleDB(fileName, (std::size_t)(fileStream.tellg()), loadValues))
+      , sampleContainer_(*database_)
+      , orientations_(new boost::shared_ptr<const sampling::OrientationBins>)
       , disableEndEffectorCollision_(disableEndEffectorCollision)
       , grasps_(grasps)
     {
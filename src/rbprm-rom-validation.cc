@@ -18,8 +18,11 @@
 #include <hpp/fcl/collision.h>
 #include <hpp/fcl/BVH/BVH_model.h>
 #include <hpp/rbprm/rbprm-validation-report.hh>
+#include <hpp/rbprm/random.hh>
 #include "utils/algorithms.h"
 
+#include <algorithm>
+
 namespace hpp {
   using namespace core;
   namespace rbprm {
@@ -37,8 +40,22 @@ namespace hpp {
         , filter_(affFilters)
         , unusedReport_(new CollisionValidationReport)
         , optional_(false)
+        , pairsChanged_(true)
+        , nbPairs_(0)
     { }
 
+    void RbPrmRomValidation::addObstacle (const CollisionObjectPtr_t& object)
+    {
+        CollisionValidation::addObstacle(object);
+        pairsChanged_ = true;
+    }
+
+    void RbPrmRomValidation::removeObstacleFromJoint (const JointPtr_t& joint, const CollisionObjectPtr_t& obstacle)
+    {
+        CollisionValidation::removeObstacleFromJoint(joint, obstacle);
+        pairsChanged_ = true;
+    }
+
     bool RbPrmRomValidation::validate (const Configuration_t& config)
     {
         return validate(config, unusedReport_);
@@ -49,7 +66,8 @@ namespace hpp {
     {
       ValidationReportPtr_t romReport;
 
-      bool collision = !hpp::core::CollisionValidation::validate(config, romReport);
+      bool collision = affordanceIndex_ ? !validateNearbyObstacles(config, romReport)
+                                        : !hpp::core::CollisionValidation::validate(config, romReport);
       //CollisionValidationReportPtr_t reportCast = boost::dynamic_pointer_cast<CollisionValidationReport>(romReport);
       //hppDout(notice,"number of contacts  : "<<reportCast->result.numContacts());
       //hppDout(notice,"contact 1 "<<reportCast->result.getContact(0).pos);
@@ -97,11 +115,81 @@ namespace hpp {
     }
 
 
+    void RbPrmRomValidation::updateNearbyPairs ()
+    {
+      romObjects_.clear();
+      indexedPairs_.clear();
+      unindexedPairs_.clear();
+      for(CollisionPairs_t::const_iterator it = collisionPairs_.begin() ; it != collisionPairs_.end() ; ++it){
+        if(std::find(romObjects_.begin(), romObjects_.end(), it->first) == romObjects_.end())
+          romObjects_.push_back(it->first);
+        if(affordanceIndex_->contains(it->second))
+          indexedPairs_[it->second].push_back(*it);
+        else
+          unindexedPairs_.push_back(*it);
+      }
+      nbPairs_ = collisionPairs_.size();
+      pairsChanged_ = false;
+    }
+
+    namespace
+    {
+      /// \return true if one of the pairs is in collision, the report then describes the first one
+      bool collidePairs (const std::vector<CollisionPair_t>& pairs, const fcl::CollisionRequest& request,
+                         ValidationReportPtr_t& validationReport)
+      {
+        fcl::CollisionResult collisionResult;
+        for(std::vector<CollisionPair_t>::const_iterator it = pairs.begin() ; it != pairs.end() ; ++it){
+          collisionResult.clear();
+          if(fcl::collide(it->first->fcl().get(), it->second->fcl().get(), request, collisionResult) != 0){
+            CollisionValidationReportPtr_t report(new CollisionValidationReport);
+            report->object1 = it->first;
+            report->object2 = it->second;
+            report->result = collisionResult;
+            validationReport = report;
+            return true;
+          }
+        }
+        return false;
+      }
+    }
+
+    bool RbPrmRomValidation::validateNearbyObstacles (const Configuration_t& config,
+                    ValidationReportPtr_t& validationReport)
+    {
+      if(pairsChanged_ || nbPairs_ != collisionPairs_.size())
+        updateNearbyPairs();
+      robot_->currentConfiguration (config);
+      robot_->computeForwardKinematics ();
+      if(romObjects_.empty())
+        return true;
+      fcl::AABB romBox = AffordanceIndex::worldAABB(romObjects_.front());
+      for(model::ObjectVector_t::const_iterator it = romObjects_.begin() + 1 ; it != romObjects_.end() ; ++it)
+        romBox += AffordanceIndex::worldAABB(*it);
+      // the obstacle of the first pair is the last one found in collision. It is tested first,
+      // so that the contact is maintained with the same obstacle as long as possible
+      const CollisionObjectPtr_t preferred = collisionPairs_.front().second;
+      const model::ObjectVector_t nearby = affordanceIndex_->query(romBox);
+      const bool preferredNearby = std::find(nearby.begin(), nearby.end(), preferred) != nearby.end();
+      std::map<model::CollisionObjectPtr_t, T_Pairs>::const_iterator pit;
+      if(preferredNearby && (pit = indexedPairs_.find(preferred)) != indexedPairs_.end()
+              && collidePairs(pit->second, collisionRequest_, validationReport))
+        return false;
+      for(model::ObjectVector_t::const_iterator it = nearby.begin() ; it != nearby.end() ; ++it){
+        if(*it == preferred)
+          continue;
+        pit = indexedPairs_.find(*it);
+        if(pit != indexedPairs_.end() && collidePairs(pit->second, collisionRequest_, validationReport))
+          return false;
+      }
+      return !collidePairs(unindexedPairs_, collisionRequest_, validationReport);
+    }
+
     void RbPrmRomValidation::randomnizeCollisionPairs(){
       std::vector<CollisionPair_t> v;
       v.reserve(collisionPairs_.size());
       v.insert(v.end(),collisionPairs_.begin(),collisionPairs_.end());
-      std::random_shuffle(v.begin(), v.end());
+      std::random_shuffle(v.begin(), v.end(), ThreadRandom());
       collisionPairs_.clear();
       collisionPairs_.insert(collisionPairs_.end(),v.begin(),v.end());
     }
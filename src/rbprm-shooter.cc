@@ -16,13 +16,19 @@
 
 #include <hpp/core/collision-validation-report.hh>
 #include <hpp/rbprm/rbprm-shooter.hh>
+#include <hpp/rbprm/random.hh>
+#include <hpp/rbprm/sampling/sample.hh>
 #include <hpp/model/collision-object.hh>
 #include <hpp/model/joint.hh>
+#include <hpp/model/joint-configuration.hh>
 #include <hpp/fcl/collision_object.h>
 #include <hpp/fcl/BVH/BVH_model.h>
 #include <hpp/core/collision-validation.hh>
 #include <Eigen/Geometry>
 #include <hpp/model/configuration.hh>
+#include <omp.h>
+#include <algorithm>
+#include <cmath>
 #include <hpp/util/timer.hh>
 
 namespace hpp {
@@ -51,6 +57,48 @@ namespace
         return sqrt(s * (s-a) * (s-b) * (s-c));
     }
 
+    /// Builds the alias table of a discrete distribution, with Vose's method.
+    /// If all the weights are null, the distribution is uniform
+    void BuildAliasTable(const std::vector<double>& weights, std::vector<double>& probabilities, std::vector<std::size_t>& aliases)
+    {
+        const std::size_t n = weights.size();
+        probabilities.assign(n, 1.);
+        aliases.resize(n);
+        double sum = 0;
+        for(std::size_t i = 0; i < n; ++i)
+        {
+            aliases[i] = i;
+            sum += weights[i];
+        }
+        if(sum <= 0)
+            return;
+        std::vector<std::size_t> small, large;
+        for(std::size_t i = 0; i < n; ++i)
+        {
+            probabilities[i] = weights[i] * (double)n / sum;
+            if(probabilities[i] < 1.)
+                small.push_back(i);
+            else
+                large.push_back(i);
+        }
+        while(!small.empty() && !large.empty())
+        {
+            const std::size_t less = small.back(); small.pop_back();
+            const std::size_t more = large.back(); large.pop_back();
+            aliases[less] = more;
+            probabilities[more] = (probabilities[more] + probabilities[less]) - 1.;
+            if(probabilities[more] < 1.)
+                small.push_back(more);
+            else
+                large.push_back(more);
+        }
+        // remaining entries are only left because of rounding errors
+        for(std::vector<std::size_t>::const_iterator cit = small.begin(); cit != small.end(); ++cit)
+            probabilities[*cit] = 1.;
+        for(std::vector<std::size_t>::const_iterator cit = large.begin(); cit != large.end(); ++cit)
+            probabilities[*cit] = 1.;
+    }
+
     std::vector<double> getTranslationBounds(const model::RbPrmDevicePtr_t robot)
     {
         const JointPtr_t root = robot->Device::rootJoint();
@@ -90,26 +138,28 @@ namespace
         }
     }
 
-    void SampleRotationRec(ConfigurationPtr_t config, JointVector_t& jv, std::size_t& current)
+    void SampleRotationRec(ConfigurationPtr_t config, JointVector_t& jv, std::size_t& current, rbprm::RandomGenerator& generator)
     {
         JointPtr_t joint = jv[current++];
-        std::size_t rank = joint->rankInConfiguration ();
-        joint->configuration ()->uniformlySample (rank, *config);
+        rbprm::sampling::UniformlySample(joint, *config, generator);
         if(current<jv.size())
-            SampleRotationRec(config,jv,current);
+            SampleRotationRec(config,jv,current,generator);
     }
 
-    void SampleRotation(model::DevicePtr_t so3, ConfigurationPtr_t config, JointVector_t& jv)
+    void SampleRotation(model::DevicePtr_t so3, ConfigurationPtr_t config, JointVector_t& jv, rbprm::RandomGenerator& generator)
     {
         std::size_t id = 1;
         if(so3->rootJoint())
         {
             Eigen::Matrix <value_type, 3, 1> confso3;
             id+=1;
+            // z, y and x angles, each within the bounds of its joint
             model::JointPtr_t joint = so3->rootJoint();
-            for(int i =0; i <3; ++i)
+            for(int i =0; i <3; ++i, joint = joint->numberChildJoints() > 0 ? joint->childJoint(0) : 0)
             {
-                joint->configuration()->uniformlySample (i, confso3);
+                const model::JointConfiguration* jointConfig = joint->configuration();
+                confso3(i) = jointConfig->isBounded(0) ? generator.uniform(jointConfig->lowerBound(0), jointConfig->upperBound(0))
+                                                       : generator.uniform(-M_PI, M_PI);
             }
             Eigen::Quaterniond qt = Eigen::AngleAxisd(confso3(0), Eigen::Vector3d::UnitZ())
               * Eigen::AngleAxisd(confso3(1), Eigen::Vector3d::UnitY())
@@ -121,7 +171,22 @@ namespace
             (*config)(rank+3) = qt.z();
         }
         if(id < jv.size())
-            SampleRotationRec(config,jv,id);
+            SampleRotationRec(config,jv,id,generator);
+    }
+
+    rbprm::RbPrmValidationPtr_t CreateValidation(const model::RbPrmDevicePtr_t& robot, const ObjectVector_t& geometries,
+                                                 const rbprm::affMap_t& affordances, const std::vector<std::string>& filter,
+                                                 const std::map<std::string, std::vector<std::string> >& affFilters,
+                                                 const rbprm::AffordanceIndexPtr_t& affordanceIndex)
+    {
+        rbprm::RbPrmValidationPtr_t validator = rbprm::RbPrmValidation::create(robot, filter, affFilters,
+                                                                               affordances, geometries, affordanceIndex);
+        for(hpp::core::ObjectVector_t::const_iterator cit = geometries.begin();
+            cit != geometries.end(); ++cit)
+        {
+            validator->addObstacle(*cit);
+        }
+        return validator;
     }
 
     model::DevicePtr_t initSo3()
@@ -172,6 +237,71 @@ namespace
 
   namespace rbprm {
 
+    TriangleTable::TriangleTable(const model::ObjectVector_t& geometries)
+    {
+        std::size_t nbTriangles = 0;
+        for(model::ObjectVector_t::const_iterator objit = geometries.begin();
+          objit != geometries.end(); ++objit)
+            nbTriangles += GetModel((*objit)->fcl())->num_tris; // TODO NOT TRIANGLES
+        p1_.resize(3, nbTriangles); p2_.resize(3, nbTriangles); p3_.resize(3, nbTriangles);
+        normals_.resize(3, nbTriangles);
+        std::vector<double> weights; weights.reserve(nbTriangles);
+        std::size_t id = 0;
+        for(model::ObjectVector_t::const_iterator objit = geometries.begin();
+          objit != geometries.end(); ++objit)
+        {
+            const  fcl::CollisionObjectPtr_t& colObj = (*objit)->fcl();
+            BVHModelOBConst_Ptr_t model =  GetModel(colObj);
+            for(int i =0; i < model->num_tris; ++i, ++id)
+            {
+                TrianglePoints tri;
+                Triangle fcltri = model->tri_indices[i];
+                tri.p1 = colObj->getRotation() * model->vertices[fcltri[0]] + colObj->getTranslation();
+                tri.p2 = colObj->getRotation() * model->vertices[fcltri[1]] + colObj->getTranslation();
+                tri.p3 = colObj->getRotation() * model->vertices[fcltri[2]] + colObj->getTranslation();
+                weights.push_back(TriangleArea(tri));
+                fcl::Vec3f normal = (tri.p2 - tri.p1).cross(tri.p3 - tri.p1);
+                normal.normalize();
+                for(int j = 0; j < 3; ++j)
+                {
+                    p1_(j, id) = tri.p1[j]; p2_(j, id) = tri.p2[j]; p3_(j, id) = tri.p3[j];
+                    normals_(j, id) = normal[j];
+                }
+            }
+        }
+        BuildAliasTable(weights, probabilities_, aliases_);
+    }
+
+    std::size_t TriangleTable::size() const
+    {
+        return aliases_.size();
+    }
+
+    std::size_t TriangleTable::uniformTriangle(RandomGenerator& generator) const
+    {
+        return generator.index(size());
+    }
+
+    std::size_t TriangleTable::weightedTriangle(RandomGenerator& generator) const
+    {
+        const std::size_t id = generator.index(size());
+        return generator.uniform() < probabilities_[id] ? id : aliases_[id];
+    }
+
+    fcl::Vec3f TriangleTable::samplePoint(const std::size_t triangle, RandomGenerator& generator) const
+    {
+        //http://stackoverflow.com/questions/4778147/sample-random-point-in-triangle
+        const double r1 = sqrt(generator.uniform()), r2 = generator.uniform();
+        const Eigen::Vector3d p = (1 - r1) * p1_.col(triangle) + (r1 * (1 - r2)) * p2_.col(triangle)
+                + (r1 * r2) * p3_.col(triangle);
+        return fcl::Vec3f(p[0], p[1], p[2]);
+    }
+
+    fcl::Vec3f TriangleTable::normal(const std::size_t triangle) const
+    {
+        return fcl::Vec3f(normals_(0, triangle), normals_(1, triangle), normals_(2, triangle));
+    }
+
     RbPrmShooterPtr_t RbPrmShooter::create (const model::RbPrmDevicePtr_t& robot,
                                             const ObjectVector_t& geometries,
 																						const affMap_t& affordances,
@@ -200,7 +330,8 @@ namespace
       //seed = 1488449318; // downSLope (close to ground ... )
       //seed = 1492696043; // bug stairs
       //seed = 149277557 ; // stairs (work)
-      srand (seed);
+      srand (seed); // used by the hpp-core shooters
+      SeedRandom(seed);
       hppDout(notice,"&&&&&& SEED = "<<seed);
       std::cout<<"seed = "<<seed<<std::endl;
       RbPrmShooter* ptr = new RbPrmShooter (robot, geometries, affordances,
@@ -236,96 +367,93 @@ namespace
     : shootLimit_(shootLimit)
     , displacementLimit_(displacementLimit)
     , filter_(filter)
+    , affordanceIndex_(AffordanceIndex::create(affordances))
+    , triangles_(geometries)
     , robot_ (robot)
-    , validator_(rbprm::RbPrmValidation::create(robot_, filter, affFilters,
-																								affordances, geometries))
+    , validator_(CreateValidation(robot_, geometries, affordances, filter, affFilters, affordanceIndex_))
     , eulerSo3_(initSo3())
+    , geometries_(geometries)
+    , affordances_(affordances)
+    , affFilters_(affFilters)
+    , nbBatchShots_(0)
     {
-        for(hpp::core::ObjectVector_t::const_iterator cit = geometries.begin();
-            cit != geometries.end(); ++cit)
-        {
-            validator_->addObstacle(*cit);
-        }
-        this->InitWeightedTriangles(geometries);
+        // NOTHING
 		}
 
-    void RbPrmShooter::InitWeightedTriangles(const model::ObjectVector_t& geometries)
-    {
-        double sum = 0;
-        for(model::ObjectVector_t::const_iterator objit = geometries.begin();
-          objit != geometries.end(); ++objit)
-        {
-            const  fcl::CollisionObjectPtr_t& colObj = (*objit)->fcl();
-            BVHModelOBConst_Ptr_t model =  GetModel(colObj); // TODO NOT TRIANGLES
-            for(int i =0; i < model->num_tris; ++i)
-            {
-                TrianglePoints tri;
-                Triangle fcltri = model->tri_indices[i];
-                tri.p1 = colObj->getRotation() * model->vertices[fcltri[0]] + colObj->getTranslation();
-                tri.p2 = colObj->getRotation() * model->vertices[fcltri[1]] + colObj->getTranslation();
-                tri.p3 = colObj->getRotation() * model->vertices[fcltri[2]] + colObj->getTranslation();;
-                double weight = TriangleArea(tri);
-                sum += weight;
-                weights_.push_back(weight);
-                fcl::Vec3f normal = (tri.p2 - tri.p1).cross(tri.p3 - tri.p1);
-                normal.normalize();
-                triangles_.push_back(std::make_pair(normal,tri));
-            }
-            double previousWeight = 0;
-            for(std::vector<double>::iterator wit = weights_.begin();
-                wit != weights_.end(); ++wit)
-            {
-                previousWeight += (*wit) / sum;
-                (*wit) = previousWeight;
-            }
-        }
-    }
-
-  const RbPrmShooter::T_TriangleNormal &RbPrmShooter::RandomPointIntriangle() const
+  std::size_t RbPrmShooter::RandomPointIntriangle(RandomGenerator& generator) const
   {
-      return triangles_[rand() % triangles_.size()];
+      return triangles_.uniformTriangle(generator);
   }
 
-  const RbPrmShooter::T_TriangleNormal& RbPrmShooter::WeightedTriangle() const
+  std::size_t RbPrmShooter::WeightedTriangle(RandomGenerator& generator) const
   {
-      double r = ((double) rand() / (RAND_MAX));
-      std::vector<T_TriangleNormal>::const_iterator trit = triangles_.begin();
-      for(std::vector<double>::const_iterator wit = weights_.begin();
-          wit != weights_.end();
-          ++wit, ++trit)
-      {
-          if(*wit >= r) return *trit;
-      }
-      return triangles_[triangles_.size()-1]; // not supposed to happen
+      return triangles_.weightedTriangle(generator);
   }
 
 hpp::core::ConfigurationPtr_t RbPrmShooter::shoot () const
 {
     hppDout(notice,"!!! Random shoot");
+    ConfigurationPtr_t config (new Configuration_t (robot_->Device::currentConfiguration()));
+    if (!shoot(config, *validator_, ThreadRandom())) std::cout << "no config found" << std::endl;
+    hppDout(info,"shoot : "<<model::displayConfig(*config));
+    return config;
+}
+
+std::size_t RbPrmShooter::shootBatch (const std::size_t n, Eigen::MatrixXd& configurations, std::vector<bool>& valid) const
+{
+    const size_type configSize = robot_->configSize();
+    if(configurations.rows() != configSize || configurations.cols() != (size_type)n)
+        configurations.resize(configSize, n);
+    const int nbThreads = omp_get_max_threads();
+    // copying the robot is not thread safe, so the copies are created beforehand
+    while(batchValidations_.size() < (std::size_t)nbThreads)
+    {
+        BatchValidation batchValidation;
+        batchValidation.robot_ = model::RbPrmDevice::createCopy(robot_);
+        batchValidation.validator_ = CreateValidation(batchValidation.robot_, geometries_, affordances_,
+                                                      filter_, affFilters_, affordanceIndex_);
+        batchValidations_.push_back(batchValidation);
+    }
+    // the batch streams are drawn from a different seed than the thread streams
+    const boost::uint64_t seed = RandomSeed() ^ 0x5851F42D4C957F2DULL;
+    const std::size_t firstShot = nbBatchShots_;
+    nbBatchShots_ += n;
+    const Configuration_t initial = robot_->Device::currentConfiguration();
+    std::vector<char> found(n, 0);
+    #pragma omp parallel num_threads(nbThreads)
+    {
+        RbPrmValidation& validator = *batchValidations_[omp_get_thread_num()].validator_;
+        ConfigurationPtr_t config (new Configuration_t (initial));
+        #pragma omp for schedule(dynamic)
+        for(long i = 0; i < (long)n; ++i)
+        {
+            *config = initial;
+            RandomGenerator generator;
+            generator.seed(seed, firstShot + i);
+            found[i] = shoot(config, validator, generator);
+            configurations.col(i) = *config;
+        }
+    }
+    valid.assign(found.begin(), found.end());
+    return std::count(valid.begin(), valid.end(), true);
+}
+
+bool RbPrmShooter::shoot (ConfigurationPtr_t config, RbPrmValidation& validator, RandomGenerator& generator) const
+{
     HPP_DEFINE_TIMECOUNTER(SHOOT_COLLISION);
     JointVector_t jv = robot_->getJointVector ();
-    ConfigurationPtr_t config (new Configuration_t (robot_->Device::currentConfiguration()));
     std::size_t limit = shootLimit_;
     bool found(false);
     while(limit >0 && !found)
     {
         // pick one triangle randomly
-        const T_TriangleNormal* sampled(0);
-        double r = ((double) rand() / (RAND_MAX));
-        if(r > 0.3)
-            sampled = &RandomPointIntriangle();
-        else
-            sampled = &WeightedTriangle();
-				const TrianglePoints& tri = sampled->second;
-        //http://stackoverflow.com/questions/4778147/sample-random-point-in-triangle
-        double r1, r2;
-        r1 = ((double) rand() / (RAND_MAX)); r2 = ((double) rand() / (RAND_MAX));
-        Vec3f p = (1 - sqrt(r1)) * tri.p1 + (sqrt(r1) * (1 - r2)) * tri.p2
-                + (sqrt(r1) * r2) * tri.p3;
+        double r = generator.uniform();
+        const std::size_t sampled = r > 0.3 ? RandomPointIntriangle(generator) : WeightedTriangle(generator);
+        Vec3f p = triangles_.samplePoint(sampled, generator);
 
         //set configuration position to sampled point
         SetConfigTranslation(robot_,config, p);
-        SampleRotation(eulerSo3_, config, jv);
+        SampleRotation(eulerSo3_, config, jv, generator);
         // rotate and translate randomly until valid configuration found or
         // no obstacle is reachable
         ValidationReportPtr_t reportShPtr(new CollisionValidationReport);
@@ -334,8 +462,8 @@ hpp::core::ConfigurationPtr_t RbPrmShooter::shoot () const
         while(!found && limitDis >0)
         {
             HPP_START_TIMECOUNTER(SHOOT_COLLISION);
-            bool valid = validator_->validateTrunk(*config, reportShPtr);
-            found = valid && validator_->validateRoms(*config, filter_,reportShPtr);
+            bool valid = validator.validateTrunk(*config, reportShPtr);
+            found = valid && validator.validateRoms(*config, filter_,reportShPtr);
             HPP_STOP_TIMECOUNTER(SHOOT_COLLISION);
             CollisionValidationReport* report = static_cast<CollisionValidationReport*>(reportShPtr.get());
 
@@ -344,21 +472,21 @@ hpp::core::ConfigurationPtr_t RbPrmShooter::shoot () const
                 // try to rotate to reach rom
                 for(; limitDis>0 && !found && valid ; --limitDis)
                 {
-                    SampleRotation(eulerSo3_, config, jv);
+                    SampleRotation(eulerSo3_, config, jv, generator);
                     {
                     HPP_START_TIMECOUNTER(SHOOT_COLLISION);
-                    found = validator_->validate(*config, filter_);
+                    found = validator.validate(*config, filter_);
                     HPP_STOP_TIMECOUNTER(SHOOT_COLLISION);
                     }
                     if(!found)
                     {
                         Translate(robot_, config, -lastDirection *
-                                  0.2 * ((double) rand() / (RAND_MAX)));
+                                  0.2 * generator.uniform());
                     }
                     {
                     HPP_START_TIMECOUNTER(SHOOT_COLLISION);
-                    valid = validator_->validateTrunk(*config, reportShPtr);
-                    found = valid && validator_->validateRoms(*config, filter_,reportShPtr);
+                    valid = validator.validateTrunk(*config, reportShPtr);
+                    found = valid && validator.validateRoms(*config, filter_,reportShPtr);
                     HPP_STOP_TIMECOUNTER(SHOOT_COLLISION);
                     }
                 }
@@ -371,7 +499,7 @@ hpp::core::ConfigurationPtr_t RbPrmShooter::shoot () const
                 // mouve out by penetration depth
                 // v0 move away from normal
                 //get normal from collision tri
-                lastDirection = triangles_[report->result.getContact(0).b2].first;
+                lastDirection = triangles_.normal(report->result.getContact(0).b2);
                 Translate(robot_,config, lastDirection *
                           (std::abs(report->result.getContact(0).penetration_depth) +0.03));
                  limitDis--;
@@ -393,7 +521,7 @@ hpp::core::ConfigurationPtr_t RbPrmShooter::shoot () const
                 oss << i << ". min = " << ", max = " << upper << std::endl;
                 throw std::runtime_error (oss.str ());
             }
-            (*config) [offset + i] = lower + (upper - lower) * rand ()/RAND_MAX;
+            (*config) [offset + i] = generator.uniform(lower, upper);
         }
         // save the normal (code from Mylène)
        /* if(extraDim >= 3 ){
@@ -403,10 +531,8 @@ hpp::core::ConfigurationPtr_t RbPrmShooter::shoot () const
         }*/
         limit--;
     }
-    if (!found) std::cout << "no config found" << std::endl;
-    hppDout(info,"shoot : "<<model::displayConfig(*config));
     HPP_DISPLAY_TIMECOUNTER(SHOOT_COLLISION);
-    return config;
+    return found;
 }
 
 
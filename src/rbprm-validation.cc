@@ -59,10 +59,11 @@ namespace hpp {
     (const model::RbPrmDevicePtr_t& robot, const std::vector<std::string>& filter,
      const std::map<std::string, std::vector<std::string> >& affFilters,
      const std::map<std::string, std::vector<model::CollisionObjectPtr_t> >& affordances,
-     const core::ObjectVector_t& geometries)
+     const core::ObjectVector_t& geometries,
+     const AffordanceIndexPtr_t& affordanceIndex)
     {
       RbPrmValidation* ptr = new RbPrmValidation (robot, filter, affFilters,
-                                                  affordances, geometries);
+                                                  affordances, geometries, affordanceIndex);
       return RbPrmValidationPtr_t (ptr);
     }
 
@@ -72,10 +73,12 @@ namespace hpp {
                                       std::vector<std::string> >& affFilters,
                                       const std::map<std::string,
                                       std::vector<model::CollisionObjectPtr_t> >& affordances,
-                                      const core::ObjectVector_t& geometries)
+                                      const core::ObjectVector_t& geometries,
+                                      const AffordanceIndexPtr_t& affordanceIndex)
       : trunkValidation_(tuneFclValidation(robot))
       , boundValidation_(core::JointBoundValidation::create(robot))
       , romValidations_(createRomValidations(robot, affFilters))
+      , affordanceIndex_(affordanceIndex || affordances.empty() ? affordanceIndex : AffordanceIndex::create(affordances))
       , unusedReport_(new CollisionValidationReport)
     {
       for(std::vector<std::string>::const_iterator cit = filter.begin();
@@ -123,6 +126,7 @@ namespace hpp {
           if(std::find(filter.begin(), filter.end(), romIt->first) == filter.end()){
             romIt->second->setOptional(true);
           }
+          romIt->second->setAffordanceIndex(affordanceIndex_);
         }
       }
 
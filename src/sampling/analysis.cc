@@ -18,7 +18,11 @@
 #include <hpp/core/basic-configuration-shooter.hh>
 #include <hpp/model/joint-configuration.hh>
 #include <hpp/model/joint.hh>
+#include <hpp/model/collision-object.hh>
+#include <hpp/core/collision-validation.hh>
+#include <hpp/fcl/collision.h>
 #include <time.h>
+#include <omp.h>
 
 #include <Eigen/Eigen>
 #include <Eigen/SVD>
@@ -37,48 +41,46 @@ namespace
       TRANSLATION   = 2   // Only translational jacobian is considered
     };
 
-    Eigen::JacobiSVD<Eigen::MatrixXd> svd(const sampling::Sample& sample, const JacobianMode mode)
+    Eigen::MatrixXd jacobian(const sampling::Sample& sample)
     {
-        switch (mode) {
-        case ALL:
-            return Eigen::JacobiSVD<Eigen::MatrixXd>(sample.jacobian_);
-        case TRANSLATION:
-            return Eigen::JacobiSVD<Eigen::MatrixXd>(sample.jacobian_.block(0,0,3,sample.jacobian_.cols()));
-        case ROTATION:
-            return Eigen::JacobiSVD<Eigen::MatrixXd>(sample.jacobian_.block(3,0,3,sample.jacobian_.cols()));
-        default:
-            throw std::runtime_error ("Can not perform SVD on subjacobian, unknown JacobianMode");
-            break;
-        }
+        if(sample.jacobian_.cols() == 0)
+            throw std::runtime_error ("Jacobian analysis on a database built without its jacobians");
+        return sample.jacobian_.cast<double>();
     }
 
-    double manipulability(const JacobianMode mode, const SampleDB& /*sampleDB*/, const sampling::Sample& sample)
+    Eigen::MatrixXd subJacobian(const Eigen::MatrixXd& j, const JacobianMode mode)
     {
-        double det;
-        Eigen::MatrixXd sub;
         switch (mode) {
         case ALL:
-            det = sample.jacobianProduct_.determinant();
-            break;
+            return j;
         case TRANSLATION:
-            sub = sample.jacobian_.block(0,0,3,sample.jacobian_.cols());
-            det = (sub*sub.transpose()).determinant();
-            break;
+            return j.block(0,0,3,j.cols());
         case ROTATION:
-            sub = sample.jacobian_.block(3,0,3,sample.jacobian_.cols());
-            det = (sub*sub.transpose()).determinant();
-            break;
+            return j.block(3,0,3,j.cols());
         default:
             throw std::runtime_error ("Can not compute subjacobian, unknown JacobianMode");
             break;
         }
+    }
+
+    Eigen::JacobiSVD<Eigen::MatrixXd> svd(const sampling::Sample& sample, const JacobianMode mode)
+    {
+        return Eigen::JacobiSVD<Eigen::MatrixXd>(subJacobian(jacobian(sample), mode));
+    }
+
+    double manipulability(const Eigen::MatrixXd& sub)
+    {
+        const double det = (sub*sub.transpose()).determinant();
         return det > 0 ? sqrt(det) : 0;
     }
 
-    double isotropy(const JacobianMode mode, const SampleDB& /*sampleDB*/, const sampling::Sample& sample)
+    double manipulability(const JacobianMode mode, const SampleDB& /*sampleDB*/, const sampling::Sample& sample)
+    {
+        return manipulability(subJacobian(jacobian(sample), mode));
+    }
+
+    double isotropy(const Eigen::VectorXd& S)
     {
-        Eigen::JacobiSVD<Eigen::MatrixXd> svdOfJ(svd(sample, mode));
-        const Eigen::VectorXd S = svdOfJ.singularValues();
         double min = std::numeric_limits<double>::max();
         double max = 0;
         for(int i =0; i < S.rows();++i)
@@ -88,12 +90,10 @@ namespace
             if(v > max) max = v;
         }
         return  (max > 0) ? 1 - sqrt(1 - min*min / max* max) : 0;
-    }    
+    }
 
-    double minSing(const JacobianMode mode, const SampleDB& /*sampleDB*/, const sampling::Sample& sample)
+    double minSing(const Eigen::VectorXd& S)
     {
-        Eigen::JacobiSVD<Eigen::MatrixXd> svdOfJ(svd(sample, mode));
-        const Eigen::VectorXd S = svdOfJ.singularValues();
         double min = std::numeric_limits<double>::max();
         for(int i =0; i < S.rows();++i)
         {
@@ -103,10 +103,8 @@ namespace
         return  min;
     }
 
-    double maxSing(const JacobianMode mode, const SampleDB& /*sampleDB*/, const sampling::Sample& sample)
+    double maxSing(const Eigen::VectorXd& S)
     {
-        Eigen::JacobiSVD<Eigen::MatrixXd> svdOfJ(svd(sample, mode));
-        const Eigen::VectorXd S = svdOfJ.singularValues();
         double max = -std::numeric_limits<double>::max();
         for(int i =0; i < S.rows();++i)
         {
@@ -116,6 +114,66 @@ namespace
         return  max;
     }
 
+    double isotropy(const JacobianMode mode, const SampleDB& /*sampleDB*/, const sampling::Sample& sample)
+    {
+        return isotropy(svd(sample, mode).singularValues());
+    }
+
+    double minSing(const JacobianMode mode, const SampleDB& /*sampleDB*/, const sampling::Sample& sample)
+    {
+        return minSing(svd(sample, mode).singularValues());
+    }
+
+    double maxSing(const JacobianMode mode, const SampleDB& /*sampleDB*/, const sampling::Sample& sample)
+    {
+        return maxSing(svd(sample, mode).singularValues());
+    }
+
+    const std::string modeSuffixes[3] = {"", "Rot", "Tr"};
+
+    // evaluates the jacobian analyses of all modes, with a single svd per mode.
+    // values are written in the order of AnalysisFactory::jacobianAnalyses_
+    void jacobianAnalyses(const Eigen::MatrixXd& j, T_Double& values)
+    {
+        std::size_t i = 0;
+        for(int mode = 0; mode < 3; ++mode)
+        {
+            const Eigen::MatrixXd sub = subJacobian(j, JacobianMode(mode));
+            const Eigen::VectorXd S = Eigen::JacobiSVD<Eigen::MatrixXd>(sub).singularValues();
+            values[i++] = manipulability(sub);
+            values[i++] = isotropy(S);
+            values[i++] = minSing(S);
+            values[i++] = maxSing(S);
+        }
+    }
+
+    void storedJacobianAnalyses(const SampleDB& /*sampleDB*/, const sampling::Sample& sample, T_Double& values)
+    {
+        jacobianAnalyses(jacobian(sample), values);
+    }
+
+    // (limb, effector) joints of a copy of the robot
+    typedef std::vector<std::pair<model::JointPtr_t, model::JointPtr_t> > T_LimbCopies;
+
+    // computes the jacobian of the sample again, on the copy of the robot of the calling thread
+    void recomputedJacobianAnalyses(const T_LimbCopies& copies, const SampleDB& /*sampleDB*/, const sampling::Sample& sample, T_Double& values)
+    {
+        const T_LimbCopies::value_type& copy = copies[omp_get_thread_num()];
+        jacobianAnalyses(ComputeJacobian(copy.first, copy.second, sample), values);
+    }
+
+    rbprm::T_Limb::const_iterator findLimb(const rbprm::RbPrmFullBodyPtr_t& fullBody, const sampling::Sample& sample)
+    {
+        rbprm::T_Limb::const_iterator cit = fullBody->GetLimbs().begin();
+        for(; cit != fullBody->GetLimbs().end(); ++cit)
+        {
+            if(cit->second->limb_->rankInConfiguration() == sample.startRank_)
+                break;
+        }
+        if(cit == fullBody->GetLimbs().end())
+            throw std::runtime_error ("Impossible to match sample with a limb");
+        return cit;
+    }
 
     struct FullBodyDB
     {
@@ -158,29 +216,186 @@ namespace
 
     FullBodyDB* FullBodyDB::instance_ = new FullBodyDB;
 
-    // computing probability of auto collision given a large number of full body samples
-    double selfCollisionProbability(rbprm::RbPrmFullBodyPtr_t fullBody , const SampleDB& /*sampleDB*/, const sampling::Sample& sample)
+    // gives access to the self collision pairs of a device
+    struct SelfCollisionPairs : public core::CollisionValidation
+    {
+        SelfCollisionPairs(const model::DevicePtr_t& device) : core::CollisionValidation(device) {}
+        const core::CollisionPairs_t& pairs() const {return collisionPairs_;}
+    };
+
+    bool isInSubTree(const model::JointPtr_t root, model::JointPtr_t joint)
+    {
+        for(; joint; joint = joint->parentJoint())
+        {
+            if(joint == root)
+                return true;
+        }
+        return false;
+    }
+
+    fcl::Transform3f transform(const model::CollisionObjectPtr_t& object)
     {
-        model::DevicePtr_t device = fullBody->device_;
-        model::Configuration_t save(device->currentConfiguration());
-        FullBodyDB& fullBodyDB = FullBodyDB::Instance(device);
-        core::CollisionValidationPtr_t colVal = core::CollisionValidation::create(device);
-        std::size_t totalSamples = fullBodyDB.fullBodyConfigs_.size(), totalNoCollisions =  0;
-        for(std::vector<model::Configuration_t>::const_iterator cit = fullBodyDB.fullBodyConfigs_.begin();
-            cit != fullBodyDB.fullBodyConfigs_.end(); ++cit)
+        return object->fcl()->getTransform();
+    }
+
+    /// Computes the self collision probability of the samples of a limb.
+    /// Only the collision pairs involving the limb are tested. The pose of the
+    /// limb bodies relatively to the limb parent joint only depends on the sample,
+    /// and the poses of the other bodies only depend on the FullBodyDB configuration:
+    /// both are computed once, so that no forward kinematics is required in the
+    /// collision loop.
+    struct SelfCollisionEngine
+    {
+        SelfCollisionEngine(const model::DevicePtr_t& device, const rbprm::RbPrmLimbPtr_t& limb, const FullBodyDB& fullBodyDB)
+            : limb_(limb)
+        {
+            SelfCollisionPairs colVal(device);
+            std::map<model::CollisionObjectPtr_t, std::size_t> limbIds, otherIds;
+            const core::CollisionPairs_t& pairs = colVal.pairs();
+            for(core::CollisionPairs_t::const_iterator cit = pairs.begin(); cit != pairs.end(); ++cit)
+            {
+                bool firstInLimb = isInSubTree(limb->limb_, cit->first->joint());
+                bool secondInLimb = isInSubTree(limb->limb_, cit->second->joint());
+                if(!firstInLimb && !secondInLimb)
+                    continue; // pairs not involving the limb are valid for all FullBodyDB configurations
+                if(firstInLimb && secondInLimb)
+                    intraPairs_.push_back(std::make_pair(objectId(cit->first, limbIds, limbObjects_), objectId(cit->second, limbIds, limbObjects_)));
+                else if(firstInLimb)
+                    limbPairs_.push_back(std::make_pair(objectId(cit->first, limbIds, limbObjects_), objectId(cit->second, otherIds, otherObjects_)));
+                else
+                    limbPairs_.push_back(std::make_pair(objectId(cit->second, limbIds, limbObjects_), objectId(cit->first, otherIds, otherObjects_)));
+            }
+            model::Configuration_t save(device->currentConfiguration());
+            const model::JointPtr_t parent = limb->limb_->parentJoint();
+            const std::size_t nbOthers = otherObjects_.size();
+            otherTransforms_.reserve(fullBodyDB.fullBodyConfigs_.size() * nbOthers);
+            parentTransforms_.reserve(fullBodyDB.fullBodyConfigs_.size());
+            for(std::vector<model::Configuration_t>::const_iterator cit = fullBodyDB.fullBodyConfigs_.begin();
+                cit != fullBodyDB.fullBodyConfigs_.end(); ++cit)
+            {
+                device->currentConfiguration(*cit);
+                device->computeForwardKinematics();
+                parentTransforms_.push_back(parent->currentTransformation());
+                for(std::size_t i = 0; i < nbOthers; ++i)
+                    otherTransforms_.push_back(transform(otherObjects_[i]));
+            }
+            device->currentConfiguration(save);
+            device->computeForwardKinematics();
+        }
+
+        static std::size_t objectId(const model::CollisionObjectPtr_t& object, std::map<model::CollisionObjectPtr_t, std::size_t>& ids,
+                                    model::ObjectVector_t& objects)
         {
-            model::Configuration_t conf = *cit;
-            sampling::Load(sample,conf);
+            std::map<model::CollisionObjectPtr_t, std::size_t>::const_iterator cit = ids.find(object);
+            if(cit != ids.end())
+                return cit->second;
+            ids.insert(std::make_pair(object, objects.size()));
+            objects.push_back(object);
+            return objects.size() - 1;
+        }
+
+        /// Poses of the limb bodies relatively to the parent joint of the limb, for a sample.
+        /// Uses the forward kinematics of device, which must not be shared with another thread.
+        std::vector<fcl::Transform3f> limbTransforms(const model::DevicePtr_t& device, const sampling::Sample& sample) const
+        {
+            model::Configuration_t save(device->currentConfiguration());
+            model::Configuration_t conf(save);
+            sampling::Load(sample, conf);
             device->currentConfiguration(conf);
             device->computeForwardKinematics();
-            core::ValidationReportPtr_t colRep(new core::CollisionValidationReport);
+            const fcl::Transform3f parentInv = fcl::inverse(limb_->limb_->parentJoint()->currentTransformation());
+            std::vector<fcl::Transform3f> res;
+            for(model::ObjectVector_t::const_iterator cit = limbObjects_.begin(); cit != limbObjects_.end(); ++cit)
+                res.push_back(parentInv * transform(*cit));
+            device->currentConfiguration(save);
+            device->computeForwardKinematics();
+            return res;
+        }
+
+        static bool collide(const model::CollisionObjectPtr_t& o1, const fcl::Transform3f& tf1,
+                            const model::CollisionObjectPtr_t& o2, const fcl::Transform3f& tf2)
+        {
+            fcl::CollisionRequest req;
+            fcl::CollisionResult result;
+            return fcl::collide(o1->fcl()->collisionGeometry().get(), tf1, o2->fcl()->collisionGeometry().get(), tf2, req, result) > 0;
+        }
+
+        /// \param limbTransforms poses of the limb bodies relatively to the limb parent joint
+        double probability(const std::vector<fcl::Transform3f>& limbTransforms) const
+        {
+            for(std::vector<std::pair<std::size_t, std::size_t> >::const_iterator cit = intraPairs_.begin(); cit != intraPairs_.end(); ++cit)
+            {
+                if(collide(limbObjects_[cit->first], limbTransforms[cit->first], limbObjects_[cit->second], limbTransforms[cit->second]))
+                    return 0.;
+            }
+            const long nbConfigs = (long)parentTransforms_.size();
+            const std::size_t nbOthers = otherObjects_.size();
+            long totalNoCollisions = 0;
+            #pragma omp parallel for schedule(dynamic, 64) reduction(+:totalNoCollisions)
+            for(long i = 0; i < nbConfigs; ++i)
+            {
+                bool collision = false;
+                for(std::vector<std::pair<std::size_t, std::size_t> >::const_iterator cit = limbPairs_.begin();
+                    cit != limbPairs_.end() && !collision; ++cit)
+                {
+                    collision = collide(limbObjects_[cit->first], parentTransforms_[i] * limbTransforms[cit->first],
+                                        otherObjects_[cit->second], otherTransforms_[i * nbOthers + cit->second]);
+                }
+                if(!collision)
+                    ++totalNoCollisions;
+            }
+            return (double)(totalNoCollisions) / (double)(nbConfigs);
+        }
 
-            if (colVal->validate(conf,colRep))
-                ++totalNoCollisions;
+        const rbprm::RbPrmLimbPtr_t limb_;
+        model::ObjectVector_t limbObjects_;
+        model::ObjectVector_t otherObjects_;
+        /// pairs of limb objects
+        std::vector<std::pair<std::size_t, std::size_t> > intraPairs_;
+        /// pairs of (limb object, other object)
+        std::vector<std::pair<std::size_t, std::size_t> > limbPairs_;
+        /// transformation of the limb parent joint, for each FullBodyDB configuration
+        std::vector<fcl::Transform3f> parentTransforms_;
+        /// transformation of each other object, for each FullBodyDB configuration
+        std::vector<fcl::Transform3f> otherTransforms_;
+    };
+    typedef boost::shared_ptr<SelfCollisionEngine> SelfCollisionEnginePtr_t;
+    typedef std::map<std::size_t, SelfCollisionEnginePtr_t> T_SelfCollisionEngine;
+
+    // computing probability of auto collision given a large number of full body samples.
+    // engines are built once per limb, identified by the rank of its sample in the configuration.
+    double selfCollisionProbability(rbprm::RbPrmFullBodyPtr_t fullBody, boost::shared_ptr<T_SelfCollisionEngine> engines,
+                                    const SampleDB& /*sampleDB*/, const sampling::Sample& sample)
+    {
+        SelfCollisionEnginePtr_t engine;
+        std::vector<fcl::Transform3f> limbTransforms;
+        // the device of fullBody is modified, so forward kinematics computations are serialized
+        #pragma omp critical (selfCollisionProbability)
+        {
+            model::DevicePtr_t device = fullBody->device_;
+            T_SelfCollisionEngine::const_iterator eit = engines->find(sample.startRank_);
+            if(eit == engines->end())
+            {
+                rbprm::T_Limb::const_iterator cit = fullBody->GetLimbs().begin();
+                for(; cit != fullBody->GetLimbs().end(); ++cit)
+                {
+                    if(cit->second->limb_->rankInConfiguration() == sample.startRank_)
+                        break;
+                }
+                if(cit != fullBody->GetLimbs().end())
+                {
+                    engine = SelfCollisionEnginePtr_t(new SelfCollisionEngine(device, cit->second, FullBodyDB::Instance(device)));
+                    engines->insert(std::make_pair(sample.startRank_, engine));
+                }
+            }
+            else
+                engine = eit->second;
+            if(engine)
+                limbTransforms = engine->limbTransforms(device, sample);
         }
-        device->currentConfiguration(save);
-        device->computeForwardKinematics();
-        return (double)(totalNoCollisions) / (double)(totalSamples);
+        if(!engine)
+            throw std::runtime_error ("Impossible to match sample with a limb");
+        return engine->probability(limbTransforms);
     }
 
     void distanceRec(const ConfigurationIn_t conf, const std::string& lastJoint, model::JointPtr_t currentJoint, double& currentDistance)
@@ -200,19 +415,10 @@ namespace
 
     double distanceToLimits(rbprm::RbPrmFullBodyPtr_t fullBody , const SampleDB& /*sampleDB*/, const sampling::Sample& sample)
     {
-        // find limb name
-        rbprm::T_Limb::const_iterator cit = fullBody->GetLimbs().begin();
-        for(; cit != fullBody->GetLimbs().end(); ++cit)
-        {
-            if(cit->second->limb_->rankInConfiguration() == sample.startRank_)
-                break;
-        }
-        if(cit == fullBody->GetLimbs().end())
-        {
-            throw std::runtime_error ("Impossible to match sample with a limb");
-        }
-        model::DevicePtr_t device = fullBody->device_;
-        model::Configuration_t conf(device->currentConfiguration());
+        const rbprm::T_Limb::const_iterator cit = findLimb(fullBody, sample);
+        // only the configuration of the limb is read: the current configuration of the device,
+        // which may be modified by another thread, is not used
+        model::Configuration_t conf(model::Configuration_t::Zero(fullBody->device_->configSize()));
         double distance = 1; //std::numeric_limits<double>::max();
         sampling::Load(sample,conf);
         distanceRec(conf, cit->second->effector_->name(), cit->second->limb_, distance);
@@ -225,27 +431,38 @@ namespace
 AnalysisFactory::AnalysisFactory(hpp::rbprm::RbPrmFullBodyPtr_t device)
     : device_(device)
 {
-    evaluate_.insert(std::make_pair("manipulability", boost::bind(&manipulability, JacobianMode(0), _1, _2)));
-    evaluate_.insert(std::make_pair("isotropy", boost::bind(&isotropy, JacobianMode(0), _1, _2)));
-    evaluate_.insert(std::make_pair("minimumSingularValue", boost::bind(&minSing, JacobianMode(0), _1, _2)));
-    evaluate_.insert(std::make_pair("maximumSingularValue", boost::bind(&maxSing, JacobianMode(0), _1, _2)));
-
-    evaluate_.insert(std::make_pair("manipulabilityRot", boost::bind(&manipulability, JacobianMode(1), _1, _2)));
-    evaluate_.insert(std::make_pair("isotropyRot", boost::bind(&isotropy, JacobianMode(1), _1, _2)));
-    evaluate_.insert(std::make_pair("minimumSingularValueRot", boost::bind(&minSing, JacobianMode(1), _1, _2)));
-    evaluate_.insert(std::make_pair("maximumSingularValueRot", boost::bind(&maxSing, JacobianMode(1), _1, _2)));
-
-    evaluate_.insert(std::make_pair("manipulabilityTr", boost::bind(&manipulability, JacobianMode(2), _1, _2)));
-    evaluate_.insert(std::make_pair("isotropyTr", boost::bind(&isotropy, JacobianMode(2), _1, _2)));
-    evaluate_.insert(std::make_pair("minimumSingularValueTr", boost::bind(&minSing, JacobianMode(2), _1, _2)));
-    evaluate_.insert(std::make_pair("maximumSingularValueTr", boost::bind(&maxSing, JacobianMode(2), _1, _2)));
-
-    evaluate_.insert(std::make_pair("selfCollisionProbability", boost::bind(&selfCollisionProbability, boost::ref(device_), _1, _2)));
+    typedef double (*singular) (const JacobianMode, const SampleDB&, const sampling::Sample&);
+    for(int mode = 0; mode < 3; ++mode)
+    {
+        const std::string& suffix = modeSuffixes[mode];
+        evaluate_.insert(std::make_pair("manipulability" + suffix, boost::bind((singular)&manipulability, JacobianMode(mode), _1, _2)));
+        evaluate_.insert(std::make_pair("isotropy" + suffix, boost::bind((singular)&isotropy, JacobianMode(mode), _1, _2)));
+        evaluate_.insert(std::make_pair("minimumSingularValue" + suffix, boost::bind((singular)&minSing, JacobianMode(mode), _1, _2)));
+        evaluate_.insert(std::make_pair("maximumSingularValue" + suffix, boost::bind((singular)&maxSing, JacobianMode(mode), _1, _2)));
+        jacobianAnalyses_.push_back("manipulability" + suffix);
+        jacobianAnalyses_.push_back("isotropy" + suffix);
+        jacobianAnalyses_.push_back("minimumSingularValue" + suffix);
+        jacobianAnalyses_.push_back("maximumSingularValue" + suffix);
+    }
+
+    evaluate_.insert(std::make_pair("selfCollisionProbability", boost::bind(&selfCollisionProbability, boost::ref(device_),
+                                                                              boost::shared_ptr<T_SelfCollisionEngine>(new T_SelfCollisionEngine), _1, _2)));
     evaluate_.insert(std::make_pair("jointLimitsDistance", boost::bind(&distanceToLimits, boost::ref(device_), _1, _2)));
 }
 
 AnalysisFactory::~AnalysisFactory(){}
 
+T_evaluate AnalysisFactory::CopyEvaluations() const
+{
+    T_evaluate res(evaluate_);
+    // the copy is owned by the returned evaluations
+    const rbprm::RbPrmFullBodyPtr_t fullBody = device_->clone();
+    res["selfCollisionProbability"] = boost::bind(&selfCollisionProbability, fullBody,
+                                                  boost::shared_ptr<T_SelfCollisionEngine>(new T_SelfCollisionEngine), _1, _2);
+    res["jointLimitsDistance"] = boost::bind(&distanceToLimits, fullBody, _1, _2);
+    return res;
+}
+
 bool AnalysisFactory::AddAnalysis(const std::string& name, const evaluate func)
 {
     if(evaluate_.find(name) != evaluate_.end())
@@ -253,3 +470,21 @@ bool AnalysisFactory::AddAnalysis(const std::string& name, const evaluate func)
     evaluate_.insert(std::make_pair(name,func));
     return true;
 }
+
+SampleDB& AnalysisFactory::AddJacobianAnalyses(SampleDB& database, bool sortSamples) const
+{
+    if(HasJacobians(database))
+        return addValues(database, jacobianAnalyses_, &storedJacobianAnalyses, sortSamples, true);
+    // exceptions must not leave the parallel region of addValues: the limb is found before
+    const rbprm::RbPrmLimbPtr_t limb = findLimb(device_, database.samples_.front())->second;
+    std::vector<model::DevicePtr_t> devices;
+    T_LimbCopies copies;
+    for(int i = 0; i < omp_get_max_threads(); ++i)
+    {
+        devices.push_back(device_->device_->clone());
+        copies.push_back(std::make_pair(devices.back()->getJointByName(limb->limb_->name()),
+                                        devices.back()->getJointByName(limb->effector_->name())));
+    }
+    return addValues(database, jacobianAnalyses_, boost::bind(&recomputedJacobianAnalyses, boost::cref(copies), _1, _2, _3),
+                     sortSamples, true);
+}
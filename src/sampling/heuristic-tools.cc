@@ -1,23 +1,55 @@
 #include <hpp/rbprm/sampling/heuristic-tools.hh>
 
+#include <algorithm>
+
 namespace hpp{
 namespace rbprm{
 namespace sampling{
 
+namespace
+{
+    bool lessHeight(const std::pair<double, Vec2D>& a, const std::pair<double, Vec2D>& b)
+    {
+        return a.first < b.first;
+    }
+
+    /// > 0 if c is on the left of the line (a,b), < 0 if it is on its right
+    double cross(const Vec2D & a, const Vec2D & b, const Vec2D & c)
+    {
+        return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    }
+
+    /// true if c, aligned with a and b, lies on the segment [a,b]
+    bool onSegment(const Vec2D & a, const Vec2D & b, const Vec2D & c)
+    {
+        return (c.x - a.x) * (c.x - b.x) <= 0 && (c.y - a.y) * (c.y - b.y) <= 0;
+    }
+
+    /// true if the edge (a,b) of a counterclockwise hull is removed when c is added.
+    /// As in convexHull, aligned points on the boundary are kept
+    bool visible(const Vec2D & a, const Vec2D & b, const Vec2D & c)
+    {
+        return cross(a, b, c) < 0;
+    }
+}
+
 HeuristicParam::HeuristicParam(const std::map<std::string, fcl::Vec3f> & cp, const fcl::Vec3f & comPos,
 const fcl::Vec3f & comSp, const fcl::Vec3f & comAcc, const std::string & sln, const fcl::Transform3f & tf) : contactPositions_(cp),
                                                                                                              comPosition_(comPos),
                                                                                                              comSpeed_(comSp),
                                                                                                              comAcceleration_(comAcc),
                                                                                                              sampleLimbName_(sln),
-                                                                                                             tfWorldRoot_(tf)
+                                                                                                             tfWorldRoot_(tf),
+                                                                                                             generator_(0)
 {}
 HeuristicParam::HeuristicParam(const HeuristicParam & zhp) : contactPositions_(zhp.contactPositions_),
                                                              comPosition_(zhp.comPosition_),
                                                              comSpeed_(zhp.comSpeed_),
                                                              comAcceleration_(zhp.comAcceleration_),
                                                              sampleLimbName_(zhp.sampleLimbName_),
-                                                             tfWorldRoot_(zhp.tfWorldRoot_)
+                                                             tfWorldRoot_(zhp.tfWorldRoot_),
+                                                             context_(zhp.context_),
+                                                             generator_(zhp.generator_)
 {}
 HeuristicParam & HeuristicParam::operator=(const HeuristicParam & zhp)
 {
@@ -30,10 +62,115 @@ HeuristicParam & HeuristicParam::operator=(const HeuristicParam & zhp)
         this->comAcceleration_ = zhp.comAcceleration_;
         this->sampleLimbName_ = zhp.sampleLimbName_;
         this->tfWorldRoot_ = zhp.tfWorldRoot_;
+        this->context_ = zhp.context_;
+        this->generator_ = zhp.generator_;
     }
     return *this;
 }
 
+RandomGenerator& HeuristicParam::generator() const
+{
+    return generator_ ? *generator_ : ThreadRandom();
+}
+
+void HeuristicParam::prepare(const double groundThreshold)
+{
+    context_.reset(new HeuristicContext(*this, groundThreshold));
+}
+
+HeuristicContext::HeuristicContext(const HeuristicParam & params, const double groundThreshold)
+    : contactPositions_(3, params.contactPositions_.size())
+    , candidateIgnored_(params.contactPositions_.find(params.sampleLimbName_) != params.contactPositions_.end())
+    , groundThreshold_(std::abs(groundThreshold))
+    , interest_(computeInterestPoint(params.comPosition_, params.comSpeed_, params.comAcceleration_))
+{
+    const fcl::Matrix3f & rotation = params.tfWorldRoot_.getRotation();
+    const fcl::Vec3f & translation = params.tfWorldRoot_.getTranslation();
+    for(int i = 0; i < 3; ++i)
+    {
+        for(int j = 0; j < 3; ++j)
+            worldRotation_(i,j) = rotation(i,j);
+        worldTranslation_[i] = translation[i];
+    }
+
+    // contacts sorted by increasing height, so that the ground contacts are always the first ones
+    std::vector<std::pair<double, Vec2D> > sorted;
+    std::size_t col(0);
+    for(std::map<std::string, fcl::Vec3f>::const_iterator cit = params.contactPositions_.begin();
+        cit != params.contactPositions_.end(); ++cit, ++col)
+    {
+        contactNames_.push_back(cit->first);
+        for(int i = 0; i < 3; ++i)
+            contactPositions_(i, col) = cit->second[i];
+        sorted.push_back(std::make_pair(cit->second[2], Vec2D(cit->second[0], cit->second[1])));
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), lessHeight);
+    heights_.reserve(sorted.size());
+    for(std::size_t k = 0; k < sorted.size(); ++k)
+        heights_.push_back(sorted[k].first);
+    if(sorted.size() > maxContacts)
+        return;
+    hulls_.resize(sorted.size() + 1);
+    for(std::size_t k = 0; k < sorted.size(); ++k)
+    {
+        const std::vector<Vec2D>& hull = hulls_[k];
+        std::vector<Vec2D>& next = hulls_[k+1];
+        next.resize(hull.size() + 1);
+        next.resize(addToConvexHull(hull.empty() ? 0 : &hull[0], hull.size(), sorted[k].second, &next[0]));
+    }
+}
+
+fcl::Vec3f HeuristicContext::toWorld(const fcl::Vec3f & p) const
+{
+    const Eigen::Vector3d res(worldRotation_ * Eigen::Vector3d(p[0], p[1], p[2]) + worldTranslation_);
+    return fcl::Vec3f(res[0], res[1], res[2]);
+}
+
+Vec2D HeuristicContext::centroid(const fcl::Vec3f & candidate) const
+{
+    // same selection of the ground contacts as removeNonGroundContacts
+    double minZ(heights_.empty() ? candidate[2] : heights_.front());
+    if(!candidateIgnored_ && candidate[2] < minZ)
+        minZ = candidate[2];
+    std::size_t nbGround(0);
+    while(nbGround < heights_.size() && heights_[nbGround] - minZ <= groundThreshold_)
+        ++nbGround;
+    const std::vector<Vec2D>& hull = hulls_[nbGround];
+    if(candidateIgnored_ || candidate[2] - minZ > groundThreshold_)
+        return weightedCentroidConvex2D(&hull[0], hull.size());
+    Vec2D buffer[maxContacts + 1];
+    const std::size_t size = addToConvexHull(hull.empty() ? 0 : &hull[0], hull.size(), Vec2D(candidate[0], candidate[1]), buffer);
+    return weightedCentroidConvex2D(buffer, size);
+}
+
+Vec2D computeInterestPoint(const fcl::Vec3f & comPosition, const fcl::Vec3f & comSpeed, const fcl::Vec3f & comAcceleration)
+{
+    double g(-9.80665);
+    double w2(comPosition[2]/g); // w2 < 0
+    double w1x(-10*w2); // w1 > 0
+    double w1y(-10*w2); // w1 > 0
+
+    // We want : |w1*comSpeed| > |w2*comAcceleration|
+    if(comSpeed[0] != 0)
+    {
+        while(std::abs(w1x*comSpeed[0]) <= std::abs(w2*comAcceleration[0]))
+        {
+            w1x *= 1.5;
+        }
+    }
+    if(comSpeed[1] != 0)
+    {
+        while(std::abs(w1y*comSpeed[1]) <= std::abs(w2*comAcceleration[1]))
+        {
+            w1y *= 1.5;
+        }
+    }
+
+    double x_interest(comPosition[0] + w1x*comSpeed[0] + w2*comAcceleration[0]);
+    double y_interest(comPosition[1] + w1y*comSpeed[1] + w2*comAcceleration[1]);
+    return Vec2D(x_interest, y_interest);
+}
+
 fcl::Vec3f transform(const fcl::Vec3f & p, const fcl::Vec3f & tr, const fcl::Matrix3f & ro)
 {
     fcl::Vec3f res(
@@ -275,82 +412,131 @@ Vec2D weightedCentroidConvex2D(const std::vector <Vec2D> & convexPolygon)
 {
     if(convexPolygon.empty())
         throw std::string("Impossible to find the weighted centroid of nothing (the specified convex polygon has no vertices)");
+    return weightedCentroidConvex2D(&convexPolygon[0], convexPolygon.size());
+}
 
-    Vec2D res;
-    if(convexPolygon.size() == 1)
-        res = convexPolygon[0];
-    else if(convexPolygon.size() == 2)
+Vec2D weightedCentroidConvex2D(const Vec2D* convexPolygon, const std::size_t size)
+{
+    if(size == 1)
+        return convexPolygon[0];
+    if(size == 2)
+        return Vec2D((convexPolygon[0].x + convexPolygon[1].x) / 2.0, (convexPolygon[0].y + convexPolygon[1].y) / 2.0);
+
+    // get the longest edge and define the minimum admissible threshold for counting a vertex as a single point
+    double maxDist(Vec2D::euclideanDist(convexPolygon[size-1], convexPolygon[0]));
+    for(std::size_t i = 0; i < size - 1; ++i)
     {
-        double resX((convexPolygon[0].x + convexPolygon[1].x) / 2.0);
-        double resY((convexPolygon[0].y + convexPolygon[1].y) / 2.0);
-        res = Vec2D(resX, resY);
+        double dist(Vec2D::euclideanDist(convexPolygon[i], convexPolygon[i+1]));
+        if(dist > maxDist)
+            maxDist = dist;
     }
-    else
+    double threshold(maxDist/10.0);
+
+    // start from a lonely (to the rear) point
+    std::size_t start(0);
+    while(start < size && Vec2D::euclideanDist(convexPolygon[(start + size - 1) % size], convexPolygon[start]) <= threshold)
+        ++start;
+    // all the vertices coincide
+    if(start == size)
+        return convexPolygon[0];
+
+    // look over the polygon from start, averaging the groups of close vertices
+    double resX(0.0), resY(0.0), localX(0.0), localY(0.0);
+    std::size_t nbFinal(0), nbLocal(0);
+    for(std::size_t i = 0; i < size; ++i)
     {
-        // get the longest edge and define the minimum admissible threshold for counting a vertex as a single point
-        double maxDist(Vec2D::euclideanDist(convexPolygon.back(), convexPolygon.front()));
-        for(unsigned int i = 0; i < convexPolygon.size() - 1; ++i)
+        const Vec2D & current = convexPolygon[(start + i) % size];
+        const Vec2D & next = convexPolygon[(start + i + 1) % size];
+        localX += current.x;
+        localY += current.y;
+        ++nbLocal;
+        if(Vec2D::euclideanDist(current, next) > threshold)
         {
-            double dist(Vec2D::euclideanDist(convexPolygon[i], convexPolygon[i+1]));
-            if(dist > maxDist)
-                maxDist = dist;
+            resX += localX / static_cast<double>(nbLocal);
+            resY += localY / static_cast<double>(nbLocal);
+            ++nbFinal;
+            localX = 0.0; localY = 0.0;
+            nbLocal = 0;
         }
-        double threshold(maxDist/10.0);
+    }
+    return Vec2D(resX / static_cast<double>(nbFinal), resY / static_cast<double>(nbFinal));
+}
 
-        // shift the list until starting from a lonely (to the rear) point
-        std::vector <Vec2D> shifted(convexPolygon);
-        while(Vec2D::euclideanDist(shifted.back(), shifted.front()) <= threshold)
+std::size_t addToConvexHull(const Vec2D* hull, const std::size_t size, const Vec2D& point, Vec2D* result)
+{
+    if(size == 0)
+    {
+        result[0] = point;
+        return 1;
+    }
+    if(size == 1)
+    {
+        result[0] = hull[0];
+        if(point == hull[0])
+            return 1;
+        result[1] = point;
+        return 2;
+    }
+    if(size == 2)
+    {
+        const double side = cross(hull[0], hull[1], point);
+        if(side > 0)
         {
-            shifted.push_back(shifted.front());
-            shifted.erase(shifted.begin());
+            result[0] = hull[0]; result[1] = hull[1]; result[2] = point;
+            return 3;
         }
-
-        // look over the shifted set
-        std::vector <Vec2D> finalSet, localSubset;
-        bool subsetOngoing = false;
-        shifted.push_back(shifted.front());
-
-        for(unsigned int i = 0; i < shifted.size() - 1; ++i)
+        if(side < 0)
         {
-            if(Vec2D::euclideanDist(shifted[i], shifted[i+1]) > threshold)
-            {
-                if(!subsetOngoing)
-                    finalSet.push_back(shifted[i]);
-                else
-                {
-                    localSubset.push_back(shifted[i]);
-                    double moyX(0.0), moyY(0.0);
-                    for(unsigned int j = 0; j < localSubset.size(); ++j)
-                    {
-                        moyX += localSubset[j].x;
-                        moyY += localSubset[j].y;
-                    }
-                    moyX /= static_cast<double>(localSubset.size());
-                    moyY /= static_cast<double>(localSubset.size());
-                    finalSet.push_back(Vec2D(moyX, moyY));
-                    localSubset.clear();
-                    subsetOngoing = false;
-                }
-            }
-            else
-            {
-                localSubset.push_back(shifted[i]);
-                if(!subsetOngoing)
-                    subsetOngoing = true;
-            }
+            result[0] = hull[0]; result[1] = point; result[2] = hull[1];
+            return 3;
         }
-
-        double resX(0.0), resY(0.0);
-        for(unsigned int i = 0; i < finalSet.size(); ++i)
+        // aligned points: keep the two extremities
+        if(onSegment(hull[0], hull[1], point))
+        {
+            result[0] = hull[0]; result[1] = hull[1];
+        }
+        else if(onSegment(point, hull[1], hull[0]))
         {
-            resX += finalSet[i].x;
-            resY += finalSet[i].y;
+            result[0] = point; result[1] = hull[1];
         }
-        resX /= static_cast<double>(finalSet.size());
-        resY /= static_cast<double>(finalSet.size());
-        res = Vec2D(resX, resY);
+        else
+        {
+            result[0] = hull[0]; result[1] = point;
+        }
+        return 2;
     }
-    return res;
+    // the edges seen from the point are consecutive. Find the first and last ones
+    std::size_t first(size), last(size);
+    for(std::size_t i = 0; i < size; ++i)
+    {
+        const bool current = visible(hull[i], hull[(i+1) % size], point);
+        const bool previous = visible(hull[(i + size - 1) % size], hull[i], point);
+        if(current && !previous)
+            first = i;
+        if(current && !visible(hull[(i+1) % size], hull[(i+2) % size], point))
+            last = i;
+    }
+    if(first == size)
+    {
+        // inside the hull, or on its boundary
+        std::size_t nbVertices(0);
+        for(std::size_t i = 0; i < size; ++i)
+        {
+            if(hull[i] == point)
+                return std::copy(hull, hull + size, result) - result;
+            result[nbVertices++] = hull[i];
+            if(cross(hull[i], hull[(i+1) % size], point) == 0 && onSegment(hull[i], hull[(i+1) % size], point))
+                result[nbVertices++] = point;
+        }
+        return nbVertices;
+    }
+    // the vertices between the first and last visible edges are replaced by the point
+    std::size_t nbVertices(0);
+    for(std::size_t i = (last + 1) % size; i != first; i = (i + 1) % size)
+        result[nbVertices++] = hull[i];
+    result[nbVertices++] = hull[first];
+    result[nbVertices++] = point;
+    return nbVertices;
 }
 
 void removeNonGroundContacts(std::map<std::string, fcl::Vec3f> & contacts, double groundThreshold)
@@ -15,7 +15,9 @@
 // hpp-rbprm. If not, see <http://www.gnu.org/licenses/>.
 
 #include <hpp/rbprm/sampling/heuristic.hh>
+#include <hpp/rbprm/random.hh>
 #include <time.h>
+#include <algorithm>
 
 #include <Eigen/Eigen>
 
@@ -29,6 +31,10 @@ namespace
 
 double dynamicHeuristic(const sampling::Sample & sample, const Eigen::Vector3d & /*direction*/, const Eigen::Vector3d & /*normal*/, const HeuristicParam & params)
 {
+    const HeuristicContext* context = params.context_.get();
+    if(context && !context->hulls_.empty())
+        return -Vec2D::euclideanDist(context->interest_, context->centroid(context->toWorld(sample.effectorPosition_)));
+
     fcl::Vec3f effectorPosition = transform(sample.effectorPosition_, params.tfWorldRoot_.getTranslation(), params.tfWorldRoot_.getRotation());
 
     std::map <std::string, fcl::Vec3f> contacts;
@@ -36,31 +42,7 @@ double dynamicHeuristic(const sampling::Sample & sample, const Eigen::Vector3d &
     contacts.insert(std::make_pair(params.sampleLimbName_, effectorPosition));
     removeNonGroundContacts(contacts, 0.25); // keep only ground contacts
 
-    double g(-9.80665);
-    double w2(params.comPosition_[2]/g); // w2 < 0
-    double w1x(-10*w2); // w1 > 0
-    double w1y(-10*w2); // w1 > 0
-
-    // We want : |w1*comSpeed| > |w2*comAcceleration|
-    if(params.comSpeed_[0] != 0)
-    {
-        while(std::abs(w1x*params.comSpeed_[0]) <= std::abs(w2*params.comAcceleration_[0]))
-        {
-            w1x *= 1.5;
-        }
-    }
-    if(params.comSpeed_[1] != 0)
-    {
-        while(std::abs(w1y*params.comSpeed_[1]) <= std::abs(w2*params.comAcceleration_[1]))
-        {
-            w1y *= 1.5;
-        }
-    }
-
-    double x_interest(params.comPosition_[0] + w1x*params.comSpeed_[0] + w2*params.comAcceleration_[0]);
-    double y_interest(params.comPosition_[1] + w1y*params.comSpeed_[1] + w2*params.comAcceleration_[1]);
-
-    Vec2D interest(x_interest, y_interest);
+    Vec2D interest(computeInterestPoint(params.comPosition_, params.comSpeed_, params.comAcceleration_));
 
     double result;
     try
@@ -79,43 +61,43 @@ double dynamicHeuristic(const sampling::Sample & sample, const Eigen::Vector3d &
 double EFORTHeuristic(const sampling::Sample& sample,
                       const Eigen::Vector3d& direction, const Eigen::Vector3d& normal, const HeuristicParam & /*params*/)
 {
-    double EFORT = -direction.transpose() * sample.jacobianProduct_.block<3,3>(0,0) * (-direction);
+    double EFORT = -direction.transpose() * sample.jacobianProduct_.block<3,3>(0,0).cast<double>() * (-direction);
     return EFORT * Eigen::Vector3d::UnitZ().dot(normal);
 }
 
 double EFORTNormalHeuristic(const sampling::Sample& sample,
                       const Eigen::Vector3d& direction, const Eigen::Vector3d& normal, const HeuristicParam & /*params*/)
 {
-    double EFORT = -direction.transpose() * sample.jacobianProduct_.block<3,3>(0,0) * (-direction);
+    double EFORT = -direction.transpose() * sample.jacobianProduct_.block<3,3>(0,0).cast<double>() * (-direction);
     return EFORT * direction.dot(normal);
 }
 
 double ManipulabilityHeuristic(const sampling::Sample& sample,
-                               const Eigen::Vector3d& /*direction*/, const Eigen::Vector3d& normal, const HeuristicParam & /*params*/)
+                               const Eigen::Vector3d& /*direction*/, const Eigen::Vector3d& normal, const HeuristicParam & params)
 {
     if(Eigen::Vector3d::UnitZ().dot(normal) < 0.7) return -1;
-    return sample.staticValue_ * 10000 * Eigen::Vector3d::UnitZ().dot(normal) * 100000  +  ((double)rand()) / ((double)(RAND_MAX));
+    return sample.staticValue_ * 10000 * Eigen::Vector3d::UnitZ().dot(normal) * 100000  +  params.generator().uniform();
 }
 
 double RandomHeuristic(const sampling::Sample& /*sample*/,
-                       const Eigen::Vector3d& /*direction*/, const Eigen::Vector3d& /*normal*/, const HeuristicParam & /*params*/)
+                       const Eigen::Vector3d& /*direction*/, const Eigen::Vector3d& /*normal*/, const HeuristicParam & params)
 {
-    return ((double)rand()) / ((double)(RAND_MAX));
+    return params.generator().uniform();
 }
 
 
 double ForwardHeuristic(const sampling::Sample& sample,
-                      const Eigen::Vector3d& direction, const Eigen::Vector3d& normal, const HeuristicParam & /*params*/)
+                      const Eigen::Vector3d& direction, const Eigen::Vector3d& normal, const HeuristicParam & params)
 {
-    return sample.staticValue_ * 10000 * Eigen::Vector3d::UnitZ().dot(normal) * 100  + sample.effectorPosition_.dot(fcl::Vec3f(direction(0),direction(1),direction(2))) + ((double)rand()) / ((double)(RAND_MAX));
+    return sample.staticValue_ * 10000 * Eigen::Vector3d::UnitZ().dot(normal) * 100  + sample.effectorPosition_.dot(fcl::Vec3f(direction(0),direction(1),direction(2))) + params.generator().uniform();
 }
 
 
 
 double BackwardHeuristic(const sampling::Sample& sample,
-                      const Eigen::Vector3d& direction, const Eigen::Vector3d& normal, const HeuristicParam & /*params*/)
+                      const Eigen::Vector3d& direction, const Eigen::Vector3d& normal, const HeuristicParam & params)
 {
-    return sample.staticValue_ * 10000 * Eigen::Vector3d::UnitZ().dot(normal) * 100  - sample.effectorPosition_.dot(fcl::Vec3f(direction(0),direction(1),direction(2))) + ((double)rand()) / ((double)(RAND_MAX));
+    return sample.staticValue_ * 10000 * Eigen::Vector3d::UnitZ().dot(normal) * 100  - sample.effectorPosition_.dot(fcl::Vec3f(direction(0),direction(1),direction(2))) + params.generator().uniform();
 }
 
 double StaticHeuristic(const sampling::Sample& sample,
@@ -140,6 +122,117 @@ double DistanceToLimitHeuristic(const sampling::Sample& sample,
 {
     return sample.configuration_.norm();
 }
+
+// Batch versions of the heuristics. They score the samples of a voxel in one call,
+// reading the contiguous samples of the database in order, and compute the terms
+// that only depend on the query once.
+
+/// direction^T * translational part of the jacobian product * direction
+inline double translationalEFORT(const sampling::Sample& sample, const Eigen::Vector3d& direction)
+{
+    return direction.transpose() * sample.jacobianProduct_.block<3,3>(0,0).cast<double>() * direction;
+}
+
+void EFORTBatch(const SampleVector_t& samples, const std::size_t first, const std::size_t count,
+                const Eigen::Vector3d& direction, const Eigen::Vector3d& normal, const HeuristicParam & /*params*/, double* values)
+{
+    const double z = Eigen::Vector3d::UnitZ().dot(normal);
+    for(std::size_t i = 0; i < count; ++i)
+        values[i] = translationalEFORT(samples[first + i], direction) * z;
+}
+
+void EFORTNormalBatch(const SampleVector_t& samples, const std::size_t first, const std::size_t count,
+                      const Eigen::Vector3d& direction, const Eigen::Vector3d& normal, const HeuristicParam & /*params*/, double* values)
+{
+    const double n = direction.dot(normal);
+    for(std::size_t i = 0; i < count; ++i)
+        values[i] = translationalEFORT(samples[first + i], direction) * n;
+}
+
+void StaticBatch(const SampleVector_t& samples, const std::size_t first, const std::size_t count,
+                 const Eigen::Vector3d& /*direction*/, const Eigen::Vector3d& /*normal*/, const HeuristicParam & /*params*/, double* values)
+{
+    for(std::size_t i = 0; i < count; ++i)
+        values[i] = samples[first + i].staticValue_;
+}
+
+void ManipulabilityBatch(const SampleVector_t& samples, const std::size_t first, const std::size_t count,
+                         const Eigen::Vector3d& /*direction*/, const Eigen::Vector3d& normal, const HeuristicParam & params, double* values)
+{
+    const double z = Eigen::Vector3d::UnitZ().dot(normal);
+    if(z < 0.7)
+    {
+        std::fill(values, values + count, -1.);
+        return;
+    }
+    const double factor = 10000 * z * 100000;
+    RandomGenerator& generator = params.generator();
+    for(std::size_t i = 0; i < count; ++i)
+        values[i] = samples[first + i].staticValue_ * factor + generator.uniform();
+}
+
+void RandomBatch(const SampleVector_t& /*samples*/, const std::size_t /*first*/, const std::size_t count,
+                 const Eigen::Vector3d& /*direction*/, const Eigen::Vector3d& /*normal*/, const HeuristicParam & params, double* values)
+{
+    RandomGenerator& generator = params.generator();
+    for(std::size_t i = 0; i < count; ++i)
+        values[i] = generator.uniform();
+}
+
+/// static value term plus sign * position along direction, plus noise
+void directionalBatch(const SampleVector_t& samples, const std::size_t first, const std::size_t count,
+                      const Eigen::Vector3d& direction, const Eigen::Vector3d& normal, const double sign, RandomGenerator& generator,
+                      double* values)
+{
+    const double factor = 10000 * Eigen::Vector3d::UnitZ().dot(normal) * 100;
+    const fcl::Vec3f dir(sign * direction[0], sign * direction[1], sign * direction[2]);
+    for(std::size_t i = 0; i < count; ++i)
+    {
+        const sampling::Sample& sample = samples[first + i];
+        values[i] = sample.staticValue_ * factor + sample.effectorPosition_.dot(dir) + generator.uniform();
+    }
+}
+
+void ForwardBatch(const SampleVector_t& samples, const std::size_t first, const std::size_t count,
+                  const Eigen::Vector3d& direction, const Eigen::Vector3d& normal, const HeuristicParam & params, double* values)
+{
+    directionalBatch(samples, first, count, direction, normal, 1., params.generator(), values);
+}
+
+void BackwardBatch(const SampleVector_t& samples, const std::size_t first, const std::size_t count,
+                   const Eigen::Vector3d& direction, const Eigen::Vector3d& normal, const HeuristicParam & params, double* values)
+{
+    directionalBatch(samples, first, count, direction, normal, -1., params.generator(), values);
+}
+
+void DistanceToLimitBatch(const SampleVector_t& samples, const std::size_t first, const std::size_t count,
+                          const Eigen::Vector3d& /*direction*/, const Eigen::Vector3d& /*normal*/, const HeuristicParam & /*params*/, double* values)
+{
+    for(std::size_t i = 0; i < count; ++i)
+        values[i] = samples[first + i].configuration_.norm();
+}
+
+void DynamicBatch(const SampleVector_t& samples, const std::size_t first, const std::size_t count,
+                  const Eigen::Vector3d& direction, const Eigen::Vector3d& normal, const HeuristicParam & params, double* values)
+{
+    // with a prepared context, dynamicHeuristic only projects the effector position
+    for(std::size_t i = 0; i < count; ++i)
+        values[i] = dynamicHeuristic(samples[first + i], direction, normal, params);
+}
+}
+
+batchHeuristic hpp::rbprm::sampling::GetBatchHeuristic(const heuristic evaluate)
+{
+    if(evaluate == &StaticHeuristic) return &StaticBatch;
+    if(evaluate == &EFORTHeuristic) return &EFORTBatch;
+    if(evaluate == &EFORTNormalHeuristic) return &EFORTNormalBatch;
+    if(evaluate == &ManipulabilityHeuristic) return &ManipulabilityBatch;
+    if(evaluate == &RandomHeuristic) return &RandomBatch;
+    if(evaluate == &ForwardHeuristic) return &ForwardBatch;
+    if(evaluate == &BackwardHeuristic) return &BackwardBatch;
+    if(evaluate == &DistanceToLimitHeuristic) return &DistanceToLimitBatch;
+    if(evaluate == &dynamicHeuristic) return &DynamicBatch;
+    return 0;
 }
 
 HeuristicFactory::HeuristicFactory()
@@ -158,7 +251,7 @@ HeuristicFactory::HeuristicFactory()
     //seed = 1492176551; // walk 0.3 !!
     //seed = 1493208163 ; // stairs static contacts
     std::cout<<"seed = "<<seed<<std::endl;
-    srand ( seed);
+    SeedRandom(seed);
     hppDout(notice,"SEED for heuristic = "<<seed);
     heuristics_.insert(std::make_pair("static", &StaticHeuristic));
     heuristics_.insert(std::make_pair("EFORT", &EFORTHeuristic));
@@ -169,6 +262,16 @@ HeuristicFactory::HeuristicFactory()
     heuristics_.insert(std::make_pair("backward", &BackwardHeuristic));
     heuristics_.insert(std::make_pair("jointlimits", &DistanceToLimitHeuristic));
     heuristics_.insert(std::make_pair("dynamic", &dynamicHeuristic));
+
+    batchHeuristics_.insert(std::make_pair("static", &StaticBatch));
+    batchHeuristics_.insert(std::make_pair("EFORT", &EFORTBatch));
+    batchHeuristics_.insert(std::make_pair("EFORT_Normal", &EFORTNormalBatch));
+    batchHeuristics_.insert(std::make_pair("manipulability", &ManipulabilityBatch));
+    batchHeuristics_.insert(std::make_pair("random", &RandomBatch));
+    batchHeuristics_.insert(std::make_pair("forward", &ForwardBatch));
+    batchHeuristics_.insert(std::make_pair("backward", &BackwardBatch));
+    batchHeuristics_.insert(std::make_pair("jointlimits", &DistanceToLimitBatch));
+    batchHeuristics_.insert(std::make_pair("dynamic", &DynamicBatch));
 }
 
 HeuristicFactory::~HeuristicFactory(){}
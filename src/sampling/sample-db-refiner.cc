@@ -0,0 +1,174 @@
+// Copyright (c) 2014, LAAS-CNRS
+// Authors: Steve Tonneau (steve.tonneau@laas.fr)
+//
+// This file is part of hpp-rbprm.
+// hpp-rbprm is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-rbprm is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-rbprm. If not, see <http://www.gnu.org/licenses/>.
+
+#include <hpp/rbprm/sampling/sample-db-refiner.hh>
+#include <hpp/model/device.hh>
+#include <hpp/model/joint.hh>
+#include <boost/shared_ptr.hpp>
+
+#include <algorithm>
+#include <set>
+#include <stdexcept>
+
+using namespace hpp;
+using namespace hpp::model;
+using namespace hpp::rbprm;
+using namespace hpp::rbprm::sampling;
+
+namespace
+{
+    /// maximum number of batches of random samples drawn by a refinement
+    const std::size_t maxRounds = 100;
+
+    OrientationBins buildOrientationBins(const SampleDB& database, const model::JointPtr_t limb,
+                                         const model::JointPtr_t effector, const fcl::Vec3f& normal, const bool orientations)
+    {
+        if(!orientations)
+            return OrientationBins();
+        return OrientationBins(database, limb, effector, normal);
+    }
+
+    model::DevicePtr_t cloneDevice(const model::JointPtr_t limb)
+    {
+        // same critical section as the copies of GenerateSamples
+        model::DevicePtr_t device;
+        #pragma omp critical
+        {
+            device = limb->robot()->clone();
+        }
+        return device;
+    }
+}
+
+RefinedSampleDB::RefinedSampleDB(const SampleVector_t& samples, const double resolution, const T_evaluate& data, const std::string& staticValue,
+                                 const model::JointPtr_t limb, const model::JointPtr_t effector, const fcl::Vec3f& normal, const bool orientations)
+    : database_(samples, resolution, data, staticValue)
+    , orientationBins_(buildOrientationBins(database_, limb, effector, normal, orientations))
+{
+    // NOTHING
+}
+
+SampleDBRefinerPtr_t SampleDBRefiner::create(const SampleDBPtr_t& database, const model::JointPtr_t limb, const model::JointPtr_t effector,
+                                             const fcl::Vec3f& offset, const fcl::Vec3f& normal, const bool orientations,
+                                             const T_evaluate& data, const std::string& staticValue)
+{
+    for(T_Values::const_iterator cit = database->values_.begin(); cit != database->values_.end(); ++cit)
+    {
+        if(data.find(cit->first) == data.end())
+            throw std::runtime_error("No evaluation provided for value " + cit->first + " of the database");
+    }
+    SampleDBRefiner* ptr = new SampleDBRefiner(database, limb, effector, offset, normal, orientations, data, staticValue);
+    return SampleDBRefinerPtr_t(ptr);
+}
+
+SampleDBRefiner::SampleDBRefiner(const SampleDBPtr_t& database, const model::JointPtr_t limb, const model::JointPtr_t effector,
+                                 const fcl::Vec3f& offset, const fcl::Vec3f& normal, const bool orientations,
+                                 const T_evaluate& data, const std::string& staticValue)
+    : initial_(database)
+    , device_(cloneDevice(limb))
+    , limb_(device_->getJointByName(limb->name()))
+    , effector_(device_->getJointByName(effector->name()))
+    , offset_(offset)
+    , normal_(normal)
+    , orientations_(orientations)
+    , data_(data)
+    , staticValue_(staticValue)
+    , nbRefinements_(0)
+{
+    // NOTHING
+}
+
+RefinedSampleDBPtr_t SampleDBRefiner::current() const
+{
+    return boost::atomic_load(&current_);
+}
+
+boost::uint64_t SampleDBRefiner::key(const Sample& sample) const
+{
+    const fcl::Vec3f& position = sample.effectorPosition_;
+    // keys only depend on the resolution, shared by all versions of the database
+    const octomap::OcTreeKey k = initial_->octomapTree_->coordToKey(position[0], position[1], position[2]);
+    return (boost::uint64_t)k[0] | ((boost::uint64_t)k[1] << 16) | ((boost::uint64_t)k[2] << 32);
+}
+
+void SampleDBRefiner::recordHit(const Sample& sample)
+{
+    const boost::uint64_t voxel = key(sample);
+    #pragma omp critical (voxelStatistics)
+    {
+        ++statistics_[voxel].hits_;
+    }
+}
+
+void SampleDBRefiner::recordSuccess(const Sample& sample)
+{
+    const boost::uint64_t voxel = key(sample);
+    #pragma omp critical (voxelStatistics)
+    {
+        ++statistics_[voxel].successes_;
+    }
+}
+
+T_VoxelStatistics SampleDBRefiner::statistics() const
+{
+    T_VoxelStatistics res;
+    #pragma omp critical (voxelStatistics)
+    {
+        res = statistics_;
+    }
+    return res;
+}
+
+std::size_t SampleDBRefiner::refine(const std::size_t nbSamples, const std::size_t minHits, const unsigned long long seed)
+{
+    std::size_t added = 0;
+    #pragma omp critical (sampleDBRefinement)
+    {
+        std::set<boost::uint64_t> hotVoxels;
+        const T_VoxelStatistics stats = statistics();
+        for(T_VoxelStatistics::const_iterator cit = stats.begin(); cit != stats.end(); ++cit)
+        {
+            if(cit->second.hits_ >= minHits)
+                hotVoxels.insert(cit->first);
+        }
+        SampleVector_t newSamples;
+        const std::size_t batchSize = std::max<std::size_t>(10 * nbSamples, 1000);
+        for(std::size_t round = 0; !hotVoxels.empty() && round < maxRounds && newSamples.size() < nbSamples; ++round)
+        {
+            // each batch of each refinement draws from its own random stream
+            const unsigned long long batchSeed = seed + 0x9E3779B97F4A7C15ULL * (unsigned long long)(nbRefinements_ * maxRounds + round + 1);
+            const SampleVector_t batch = GenerateSamples(limb_, effector_->name(), batchSize, offset_, batchSeed);
+            for(SampleVector_t::const_iterator cit = batch.begin(); cit != batch.end() && newSamples.size() < nbSamples; ++cit)
+            {
+                if(hotVoxels.find(key(*cit)) != hotVoxels.end())
+                    newSamples.push_back(*cit);
+            }
+        }
+        ++nbRefinements_;
+        if(!newSamples.empty())
+        {
+            const RefinedSampleDBPtr_t previous = current();
+            const SampleDB& base = previous ? previous->database_ : *initial_;
+            SampleVector_t samples(base.samples_.begin(), base.samples_.end());
+            samples.insert(samples.end(), newSamples.begin(), newSamples.end());
+            RefinedSampleDBPtr_t refined(new RefinedSampleDB(samples, base.resolution_, data_, staticValue_,
+                                                             limb_, effector_, normal_, orientations_));
+            boost::atomic_store(&current_, refined);
+            added = newSamples.size();
+        }
+    }
+    return added;
+}
@@ -10,7 +10,18 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <string>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <set>
+#include <stdint.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 using namespace hpp;
 using namespace hpp::model;
@@ -56,6 +67,26 @@ namespace
        return res;
    }
 
+    /// number of coarse levels stored above the octree leaves
+    const std::size_t coarseLevels = 3;
+
+    void computeCoarseVoxels(SampleDB& db)
+    {
+        const octomap::OcTree& octTree = *db.octomapTree_;
+        const unsigned int depth = octTree.getTreeDepth();
+        db.coarseVoxels_.assign(coarseLevels, T_CoarseVoxel());
+        for(T_VoxelSampleId::const_iterator cit = db.samplesInVoxels_.begin(); cit != db.samplesInVoxels_.end(); ++cit)
+        {
+            const fcl::Vec3f& position = db.samples_[cit->second.first].effectorPosition_;
+            for(std::size_t level = 0; level < coarseLevels; ++level)
+            {
+                const long int coarseId = octTree.search(position[0], position[1], position[2], depth - (unsigned int)(level + 1))
+                                        - octTree.getRoot();
+                db.coarseVoxels_[level].insert(std::make_pair(cit->first, coarseId));
+            }
+        }
+    }
+
     void alignSampleOrderWithOctree(SampleDB& db)
     {
         std::vector<std::size_t> realignOrderIds; // indicate how to realign each value in value vector
@@ -107,6 +138,7 @@ namespace
         db.samplesInVoxels_ = reorderedSamplesPerVoxel;
         db.values_ = reorderedValues;
         db.samples_ = reorderedSamples;
+        computeCoarseVoxels(db);
     }
 
     void sortDB(SampleDB& database)
@@ -116,6 +148,26 @@ namespace
         alignSampleOrderWithOctree(database);
     }
 
+    /// Stores normalized values in the database, and their bounds
+    void insertValues(SampleDB& database, const std::string& valueName, T_Double& values)
+    {
+        double maxValue = -std::numeric_limits<double>::max() ;
+        double minValue = std::numeric_limits<double>::max() ;
+        for(T_Double::const_iterator cit = values.begin(); cit != values.end(); ++cit)
+        {
+            maxValue = std::max(maxValue, *cit);
+            minValue = std::min(minValue, *cit);
+        }
+        database.valueBounds_.insert(std::make_pair(valueName, std::make_pair(minValue,maxValue)));
+        // now normalize values
+        double max_min = maxValue - minValue;
+        for(T_Double::iterator it = values.begin(); it != values.end(); ++it)
+        {
+            *it = (max_min != 0) ? (*it - minValue) / max_min : 0;
+        }
+        database.values_.insert(std::make_pair(valueName, values));
+    }
+
     std::map<std::size_t, fcl::CollisionObject*> generateBoxesFromOctomap(const boost::shared_ptr<const octomap::OcTree>& octTree,
                                                                 const fcl::OcTree* tree)
     {
@@ -143,7 +195,8 @@ namespace
 }
 
 SampleDB::SampleDB(const model::JointPtr_t limb, const std::string& effector,
-                   const std::size_t nbSamples, const fcl::Vec3f& offset, const double resolution, const T_evaluate& data,  const std::string& staticValue)
+                   const std::size_t nbSamples, const fcl::Vec3f& offset, const double resolution, const T_evaluate& data,  const std::string& staticValue,
+                   const bool keepJacobians)
     : resolution_(resolution)
     , samples_(GenerateSamples(limb, effector, nbSamples, offset))
     , octomapTree_(generateOctree(samples_, resolution))
@@ -158,6 +211,28 @@ SampleDB::SampleDB(const model::JointPtr_t limb, const std::string& effector,
         addValue(*this, cit->first, cit->second, sort, false);
     }
     sortDB(*this);
+    if(!keepJacobians)
+        DropJacobians(*this);
+}
+
+SampleDB::SampleDB(const SampleVector_t& samples, const double resolution, const T_evaluate& data,  const std::string& staticValue)
+    : resolution_(resolution)
+    , samples_(samples.begin(), samples.end())
+    , octomapTree_(generateOctree(samples_, resolution))
+    , octree_(new fcl::OcTree(octomapTree_))
+    , geometry_(boost::shared_ptr<fcl::CollisionGeometry>(octree_))
+    , treeObject_(geometry_)
+    , boxes_(generateBoxesFromOctomap(octomapTree_, octree_))
+{
+    std::size_t id = 0;
+    for(T_Sample::iterator it = samples_.begin(); it != samples_.end(); ++it, ++id)
+        it->id_ = id;
+    for(T_evaluate::const_iterator cit = data.begin(); cit != data.end(); ++cit)
+    {
+        bool sort = staticValue == cit->first;
+        addValue(*this, cit->first, cit->second, sort, false);
+    }
+    sortDB(*this);
 }
 
 SampleDB::~SampleDB()
@@ -179,7 +254,19 @@ OctreeReport::OctreeReport(const Sample* s, const fcl::Contact c, const double v
    // NOTHING
 }
 
-SampleDB& hpp::rbprm::sampling::addValue(SampleDB& database, const std::string& valueName, const evaluate eval, bool isStaticValue, bool sortSamples)
+void hpp::rbprm::sampling::DropJacobians(SampleDB& database)
+{
+    for(T_Sample::iterator it = database.samples_.begin(); it != database.samples_.end(); ++it)
+        Eigen::MatrixXf(6, 0).swap(it->jacobian_);
+}
+
+bool hpp::rbprm::sampling::HasJacobians(const SampleDB& database)
+{
+    return database.samples_.empty() || database.samples_.front().jacobian_.cols() > 0;
+}
+
+SampleDB& hpp::rbprm::sampling::addValue(SampleDB& database, const std::string& valueName, const evaluate eval, bool isStaticValue, bool sortSamples,
+                                         bool parallel)
 {
     T_Values::const_iterator cit = database.values_.find(valueName);
     if(cit != database.values_.end())
@@ -189,96 +276,553 @@ SampleDB& hpp::rbprm::sampling::addValue(SampleDB& database, const std::string&
     }
     else
     {
-        double maxValue = -std::numeric_limits<double>::max() ;
-        double minValue = std::numeric_limits<double>::max() ;
-        T_Double values; values.reserve(database.samples_.size());
-        for(T_Sample::iterator it = database.samples_.begin(); it != database.samples_.end(); ++it)
+        const long nbSamples = (long)database.samples_.size();
+        T_Double values(nbSamples);
+        #pragma omp parallel for schedule(dynamic, 64) if(parallel)
+        for(long i = 0; i < nbSamples; ++i)
         {
-            double val = eval(database, *it);
-            maxValue = std::max(maxValue, val);
-            minValue = std::min(minValue, val);
-            values.push_back(val);
-            if(isStaticValue)
-                it->staticValue_ = val;
+            values[i] = eval(database, database.samples_[i]);
         }
-        database.valueBounds_.insert(std::make_pair(valueName, std::make_pair(minValue,maxValue)));
-        // now normalize values
-        double max_min = maxValue - minValue;
-        for(T_Double::iterator it = values.begin(); it != values.end(); ++it)
+        if(isStaticValue)
         {
-            *it = (max_min != 0) ? (*it - minValue) / max_min : 0;
+            for(long i = 0; i < nbSamples; ++i)
+                database.samples_[i].staticValue_ = values[i];
         }
-        database.values_.insert(std::make_pair(valueName, values));
+        insertValues(database, valueName, values);
         if(sortSamples)
             sortDB(database);
     }
     return database;
 }
 
+SampleDB& hpp::rbprm::sampling::addValues(SampleDB& database, const std::vector<std::string>& valueNames, const evaluateBatch eval, bool sortSamples,
+                                          bool parallel)
+{
+    std::vector<std::size_t> newValues;
+    for(std::size_t j = 0; j < valueNames.size(); ++j)
+    {
+        if(database.values_.find(valueNames[j]) != database.values_.end())
+            hppDout (warning, "value already existing for database " << valueNames[j]);
+        else
+            newValues.push_back(j);
+    }
+    if(newValues.empty())
+        return database;
+    const long nbSamples = (long)database.samples_.size();
+    std::vector<T_Double> values(newValues.size(), T_Double(nbSamples));
+    #pragma omp parallel if(parallel)
+    {
+        T_Double sampleValues(valueNames.size());
+        #pragma omp for schedule(dynamic, 64)
+        for(long i = 0; i < nbSamples; ++i)
+        {
+            eval(database, database.samples_[i], sampleValues);
+            for(std::size_t j = 0; j < newValues.size(); ++j)
+                values[j][i] = sampleValues[newValues[j]];
+        }
+    }
+    for(std::size_t j = 0; j < newValues.size(); ++j)
+        insertValues(database, valueNames[newValues[j]], values[j]);
+    if(sortSamples)
+        sortDB(database);
+    return database;
+}
+
+struct CandidateSet::Before
+{
+    Before(const CandidateSet& set) : set_(set) {}
+    bool operator()(const std::size_t lhs, const std::size_t rhs) const {return set_.before(lhs, rhs);}
+    const CandidateSet& set_;
+};
+
+// heap ordering: the top of the heap is the best candidate
+struct CandidateSet::After
+{
+    After(const CandidateSet& set) : set_(set) {}
+    bool operator()(const std::size_t lhs, const std::size_t rhs) const {return set_.before(rhs, lhs);}
+    const CandidateSet& set_;
+};
+
+CandidateSet::CandidateSet(const std::size_t maxSize)
+    : maxSize_(maxSize)
+    , sorted_(true)
+    , heapBuilt_(false)
+    , nbExtracted_(0)
+{
+    // NOTHING
+}
+
+bool CandidateSet::before(const std::size_t lhs, const std::size_t rhs) const
+{
+    const double lv = reports_[lhs].value_, rv = reports_[rhs].value_;
+    return lv > rv || (lv == rv && lhs < rhs);
+}
+
+void CandidateSet::prune(const std::size_t limit) const
+{
+    if(reports_.size() <= limit)
+        return;
+    std::vector<std::size_t> ids(reports_.size());
+    for(std::size_t i = 0; i < ids.size(); ++i)
+        ids[i] = i;
+    std::nth_element(ids.begin(), ids.begin() + limit, ids.end(), Before(*this));
+    ids.resize(limit);
+    // kept candidates remain in insertion order
+    std::sort(ids.begin(), ids.end());
+    T_Reports kept; kept.reserve(limit);
+    for(std::vector<std::size_t>::const_iterator cit = ids.begin(); cit != ids.end(); ++cit)
+        kept.push_back(reports_[*cit]);
+    reports_.swap(kept);
+}
+
+void CandidateSet::insert(const OctreeReport& report)
+{
+    reports_.push_back(report);
+    sorted_ = reports_.size() == 1;
+    // pruning when twice the size is reached keeps insertion linear
+    if(maxSize_ > 0 && reports_.size() >= 2 * maxSize_)
+        prune(maxSize_);
+    reset();
+}
+
+void CandidateSet::merge(const CandidateSet& other)
+{
+    reports_.insert(reports_.end(), other.reports_.begin(), other.reports_.end());
+    sorted_ = reports_.size() <= 1;
+    if(maxSize_ > 0 && reports_.size() >= 2 * maxSize_)
+        prune(maxSize_);
+    reset();
+}
+
+void CandidateSet::reset()
+{
+    heap_.clear();
+    heapBuilt_ = false;
+    nbExtracted_ = 0;
+}
+
+std::size_t CandidateSet::size() const
+{
+    return (maxSize_ > 0) ? std::min(maxSize_, reports_.size()) : reports_.size();
+}
+
+const OctreeReport* CandidateSet::next()
+{
+    if(maxSize_ > 0)
+        prune(maxSize_);
+    if(sorted_)
+        return nbExtracted_ < reports_.size() ? &reports_[nbExtracted_++] : 0;
+    if(!heapBuilt_)
+    {
+        heap_.resize(reports_.size());
+        for(std::size_t i = 0; i < heap_.size(); ++i)
+            heap_[i] = i;
+        std::make_heap(heap_.begin(), heap_.end(), After(*this));
+        heapBuilt_ = true;
+    }
+    if(heap_.empty())
+        return 0;
+    std::pop_heap(heap_.begin(), heap_.end(), After(*this));
+    const std::size_t id = heap_.back();
+    heap_.pop_back();
+    ++nbExtracted_;
+    return &reports_[id];
+}
+
+CandidateSet::const_iterator CandidateSet::begin() const
+{
+    if(maxSize_ > 0)
+        prune(maxSize_);
+    if(!sorted_)
+    {
+        // the nbExtracted_ first sorted candidates are the ones already returned by next,
+        // so next can continue from the sorted vector
+        std::stable_sort(reports_.begin(), reports_.end(), sample_compare());
+        sorted_ = true;
+    }
+    return reports_.begin();
+}
+
+CandidateSet::const_iterator CandidateSet::end() const
+{
+    begin();
+    return reports_.end();
+}
+
+namespace
+{
+    Eigen::Vector3d triangleNormal(const fcl::BVHModel<fcl::OBBRSS>& surface, const int triangle)
+    {
+        const fcl::Triangle& tr = surface.tri_indices[triangle];
+        const fcl::Vec3f& v1 = surface.vertices[tr[0]];
+        const fcl::Vec3f& v2 = surface.vertices[tr[1]];
+        const fcl::Vec3f& v3 = surface.vertices[tr[2]];
+        fcl::Vec3f normal = (v2 - v1).cross(v3 - v1);
+        normal.normalize();
+        return Eigen::Vector3d(normal[0], normal[1], normal[2]);
+    }
+
+    /// Normals of the triangles of a mesh during a request. They are read from the
+    /// precomputed normals if available, otherwise computed once for each triangle hit,
+    /// so that a request without precomputed normals does not depend on the size of the mesh.
+    class RequestNormals
+    {
+    public:
+        RequestNormals(const fcl::CollisionGeometry& geometry, const T_TriangleNormals* normals)
+            : surface_(static_cast<const fcl::BVHModel<fcl::OBBRSS>&> (geometry))
+            , normals_(normals) {}
+
+        /// the reference remains valid for the duration of the request
+        const Eigen::Vector3d& operator[](const int triangle)
+        {
+            if(normals_)
+                return (*normals_)[triangle];
+            std::map<int, Eigen::Vector3d>::iterator it = computed_.find(triangle);
+            if(it == computed_.end())
+                it = computed_.insert(std::make_pair(triangle, triangleNormal(surface_, triangle))).first;
+            return it->second;
+        }
+
+    private:
+        const fcl::BVHModel<fcl::OBBRSS>& surface_;
+        const T_TriangleNormals* normals_;
+        std::map<int, Eigen::Vector3d> computed_;
+    };
+}
+
+T_TriangleNormals rbprm::sampling::ComputeTriangleNormals(const fcl::CollisionGeometry& geometry)
+{
+    T_TriangleNormals normals;
+    if(geometry.getObjectType() != fcl::OT_BVH)
+        return normals;
+    const fcl::BVHModel<fcl::OBBRSS>& surface = static_cast<const fcl::BVHModel<fcl::OBBRSS>&> (geometry);
+    normals.reserve(surface.num_tris);
+    for(int i = 0; i < surface.num_tris; ++i)
+        normals.push_back(triangleNormal(surface, i));
+    return normals;
+}
+
+void rbprm::sampling::AddAffordanceNormals(const model::ObjectVector_t& objects, T_AffordanceNormals& normals)
+{
+    for(model::ObjectVector_t::const_iterator cit = objects.begin(); cit != objects.end(); ++cit)
+    {
+        const fcl::CollisionGeometry* geometry = (*cit)->fcl()->collisionGeometry().get();
+        if(normals.find(geometry) == normals.end())
+            normals.insert(std::make_pair(geometry, ComputeTriangleNormals(*geometry)));
+    }
+}
+
+namespace
+{
+    std::vector<fcl::Vec3f> computeBinDirections()
+    {
+        // Fibonacci lattice
+        std::vector<fcl::Vec3f> directions;
+        const double goldenAngle = M_PI * (3. - std::sqrt(5.));
+        const std::size_t n = OrientationBins::nbBins;
+        for(std::size_t i = 0; i < n; ++i)
+        {
+            const double z = 1. - (2. * (double)i + 1.) / (double)n;
+            const double r = std::sqrt(1. - z * z);
+            const double theta = goldenAngle * (double)i;
+            directions.push_back(fcl::Vec3f(r * std::cos(theta), r * std::sin(theta), z));
+        }
+        return directions;
+    }
+
+    /// directions of the orientation bins, evenly distributed on the unit sphere
+    const std::vector<fcl::Vec3f>& binDirections()
+    {
+        static const std::vector<fcl::Vec3f> directions = computeBinDirections();
+        return directions;
+    }
+
+    std::size_t closestBin(const fcl::Vec3f& normal)
+    {
+        const std::vector<fcl::Vec3f>& directions = binDirections();
+        std::size_t res = 0;
+        double best = -std::numeric_limits<double>::max();
+        for(std::size_t i = 0; i < directions.size(); ++i)
+        {
+            const double d = directions[i].dot(normal);
+            if(d > best)
+            {
+                best = d;
+                res = i;
+            }
+        }
+        return res;
+    }
+
+    double angle(const fcl::Vec3f& a, const fcl::Vec3f& b)
+    {
+        return std::acos(std::max(-1., std::min(1., (double)a.dot(b))));
+    }
+}
+
+OrientationBins::OrientationBins()
+{
+    // NOTHING
+}
+
+OrientationBins::OrientationBins(const SampleDB& database, const model::JointPtr_t limb, const model::JointPtr_t effector, const fcl::Vec3f& normal)
+    : normals_(3, database.samples_.size())
+    , binSpread_(nbBins, 0.)
+{
+    model::DevicePtr_t robot = limb->robot();
+    const model::Configuration_t save = robot->currentConfiguration();
+    model::Configuration_t configuration = save;
+    std::vector<std::size_t> sampleBins; sampleBins.reserve(database.samples_.size());
+    for(std::size_t i = 0; i < database.samples_.size(); ++i)
+    {
+        Load(database.samples_[i], configuration);
+        robot->currentConfiguration(configuration);
+        robot->computeForwardKinematics();
+        const fcl::Matrix3f parentRotation = limb->parentJoint()->currentTransformation().getRotation();
+        fcl::Vec3f sampleNormal = parentRotation.transpose() * (effector->currentTransformation().getRotation() * normal);
+        sampleNormal.normalize();
+        normals_.col(i) = Eigen::Vector3d(sampleNormal[0], sampleNormal[1], sampleNormal[2]);
+        const std::size_t bin = closestBin(sampleNormal);
+        binSpread_[bin] = std::max(binSpread_[bin], angle(binDirections()[bin], sampleNormal));
+        sampleBins.push_back(bin);
+    }
+    robot->currentConfiguration(save);
+    robot->computeForwardKinematics();
+    for(T_VoxelSampleId::const_iterator cit = database.samplesInVoxels_.begin(); cit != database.samplesInVoxels_.end(); ++cit)
+    {
+        T_BinMask mask = 0;
+        for(std::size_t i = cit->second.first; i < cit->second.first + cit->second.second; ++i)
+            mask |= T_BinMask(1) << sampleBins[i];
+        voxelBins_.insert(std::make_pair(cit->first, mask));
+    }
+}
+
+OrientationBins::T_BinMask OrientationBins::acceptedBins(const fcl::Vec3f& normal, const double maxAngle) const
+{
+    const std::vector<fcl::Vec3f>& directions = binDirections();
+    T_BinMask mask = 0;
+    for(std::size_t i = 0; i < nbBins; ++i)
+    {
+        if(angle(directions[i], normal) <= maxAngle + binSpread_[i])
+            mask |= T_BinMask(1) << i;
+    }
+    return mask;
+}
+
+OrientationBins::T_BinMask OrientationBins::voxelBins(const long int voxelId) const
+{
+    std::map<long int, T_BinMask>::const_iterator cit = voxelBins_.find(voxelId);
+    return cit == voxelBins_.end() ? 0 : cit->second;
+}
+
+bool OrientationBins::accepts(const std::size_t sampleIndex, const fcl::Vec3f& normal, const double cosMaxAngle) const
+{
+    return normals_(0, sampleIndex) * normal[0] + normals_(1, sampleIndex) * normal[1]
+         + normals_(2, sampleIndex) * normal[2] >= cosMaxAngle;
+}
+
+namespace
+{
+    /// samples of a colliding voxel not yet returned, with the first triangle found in collision with it
+    struct VoxelContact
+    {
+        const fcl::Contact* contact_;
+        const Eigen::Vector3d* normal_;
+        /// triangle normal in the frame of the octree
+        fcl::Vec3f localNormal_;
+        std::size_t next_;
+        std::size_t end_;
+        /// value of the sample next_
+        double value_;
+    };
+    typedef std::vector<VoxelContact> T_VoxelContact;
+
+    struct less_first
+    {
+        bool operator()(const std::pair<double, T_VoxelContact*>& lhs, const std::pair<double, T_VoxelContact*>& rhs) const
+        {
+            return lhs.first < rhs.first;
+        }
+    };
+
+    /// Skips the samples of a voxel not aligned with the triangle normal, and evaluates the next sample.
+    /// Samples are valued by the heuristic, or by their static value if there is none.
+    /// \param orientations if not null, samples not aligned with the triangle normal are skipped
+    /// \return false if all the samples of the voxel were returned
+    bool evaluateNext(const SampleDB& sc, VoxelContact& contact, const OrientationBins* orientations, const double cosMaxAngle,
+                      const heuristic evaluate, const Eigen::Vector3d& direction, const HeuristicParam& params)
+    {
+        if(orientations)
+            while(contact.next_ < contact.end_ && !orientations->accepts(contact.next_, contact.localNormal_, cosMaxAngle))
+                ++contact.next_;
+        if(contact.next_ >= contact.end_)
+            return false;
+        const Sample& sample = sc.samples_[contact.next_];
+        contact.value_ = evaluate ? (*evaluate)(sample, direction, *contact.normal_, params) : sample.staticValue_;
+        return true;
+    }
+
+    /// \return the voxel of a coarse voxel with the best next sample, 0 if all were returned
+    VoxelContact* bestContact(T_VoxelContact& contacts)
+    {
+        VoxelContact* res = 0;
+        for(T_VoxelContact::iterator it = contacts.begin(); it != contacts.end(); ++it)
+        {
+            if(it->next_ < it->end_ && (!res || it->value_ > res->value_))
+                res = &(*it);
+        }
+        return res;
+    }
+}
+
 // TODO Samples should be Vec3f
 bool rbprm::sampling::GetCandidates(const SampleDB& sc, const fcl::Transform3f& treeTrf,
                                     const hpp::model::CollisionObjectPtr_t& o2,
                                     const fcl::Vec3f& direction, hpp::rbprm::sampling::T_OctreeReport &reports,
                                     const HeuristicParam & params, const heuristic evaluate)
+{
+    return GetCandidates(sc, treeTrf, o2, direction, reports, params, evaluate, 0);
+}
+
+bool rbprm::sampling::GetCandidates(const SampleDB& sc, const fcl::Transform3f& treeTrf,
+                                    const hpp::model::CollisionObjectPtr_t& o2,
+                                    const fcl::Vec3f& direction, hpp::rbprm::sampling::T_OctreeReport &reports,
+                                    const HeuristicParam & params, const heuristic evaluate,
+                                    const std::size_t sampleBudget, const std::size_t level)
+{
+    return GetCandidates(sc, treeTrf, o2, direction, reports, params, evaluate, sampleBudget, level, OrientationBins(), M_PI);
+}
+
+bool rbprm::sampling::GetCandidates(const SampleDB& sc, const fcl::Transform3f& treeTrf,
+                                    const hpp::model::CollisionObjectPtr_t& o2,
+                                    const fcl::Vec3f& direction, hpp::rbprm::sampling::T_OctreeReport &reports,
+                                    const HeuristicParam & params, const heuristic evaluate,
+                                    const std::size_t sampleBudget, const std::size_t level,
+                                    const OrientationBins& orientations, const double maxAngle,
+                                    const T_TriangleNormals* triangleNormals)
 {
     fcl::CollisionRequest req(1000, true);
     fcl::CollisionResult cResult;
     fcl::CollisionObjectPtr_t obj = o2->fcl();
+    assert(obj->collisionGeometry()->getObjectType() == fcl::OT_BVH); // only works with meshes
+    RequestNormals normals(*obj->collisionGeometry(), triangleNormals);
     fcl::collide(sc.geometry_.get(), treeTrf, obj->collisionGeometry().get(), obj->getTransform(), req, cResult);
     sampling::T_VoxelSampleId::const_iterator voxelIt;
     Eigen::Vector3d eDir(direction[0], direction[1], direction[2]);
-    std::vector<long int> visited;
-    int totalSamples = 0;
-    int okay = 0;
-    //hppDout(notice,"o2 name = "<<o2->name());
-    //hppDout(notice,"o2 number tri = "<<(boost::static_pointer_cast<const fcl::BVHModel<fcl::OBBRSS> >(obj->collisionGeometry()))->num_tris);
-    //hppDout(notice,"number of contact = "<<cResult.numContacts());
+    const OrientationBins* filter = (orientations.empty() || maxAngle >= M_PI) ? 0 : &orientations;
+    const double cosMaxAngle = std::cos(maxAngle);
+    const fcl::Matrix3f treeRotation = treeTrf.getRotation().transpose();
+    if(sampleBudget == 0)
+    {
+        // built-in heuristics score all the samples of a voxel at once
+        const batchHeuristic batch = evaluate ? GetBatchHeuristic(evaluate) : 0;
+        const bool useBatch = batch != 0;
+        std::vector<double> values;
+        for(std::size_t index=0; index<cResult.numContacts(); ++index)
+        {
+            const Contact& contact = cResult.getContact(index);
+            //verifying that position is theoritically reachable from next position
+            voxelIt = sc.samplesInVoxels_.find(contact.b1);
+            if(voxelIt != sc.samplesInVoxels_.end())
+            {
+                const VoxelSampleId& voxelSampleIds = voxelIt->second;
+                // the normal only depends on the contact triangle
+                const Eigen::Vector3d& eNormal = normals[contact.b2];
+                fcl::Vec3f localNormal;
+                if(filter)
+                {
+                    localNormal = treeRotation * fcl::Vec3f(eNormal[0], eNormal[1], eNormal[2]);
+                    if(!(filter->voxelBins(contact.b1) & filter->acceptedBins(localNormal, maxAngle)))
+                        continue;
+                }
+                if(useBatch)
+                {
+                    values.resize(voxelSampleIds.second);
+                    (*batch)(sc.samples_, voxelSampleIds.first, voxelSampleIds.second, eDir, eNormal, params, &values[0]);
+                }
+                for(std::size_t i = voxelSampleIds.first; i < voxelSampleIds.first + voxelSampleIds.second; ++i)
+                {
+                    if(filter && !filter->accepts(i, localNormal, cosMaxAngle))
+                        continue;
+                    const Sample& sample = sc.samples_[i];
+                    const double value = !evaluate ? 0 : useBatch ? values[i - voxelSampleIds.first] : (*evaluate)(sample, eDir, eNormal, params);
+                    reports.insert(OctreeReport(&sample, contact, value, eNormal));
+                }
+            }
+            else
+                hppDout(warning,"no voxels in specified triangle : "<<contact.b1);
+        }
+        return !reports.empty();
+    }
+
+    // group the colliding voxels by coarse voxel. A voxel is kept once, with the first
+    // triangle it collides with, so that its samples are not returned several times
+    const T_CoarseVoxel* coarseVoxels = (level > 0 && level <= sc.coarseVoxels_.size()) ? &sc.coarseVoxels_[level-1] : 0;
+    std::map<long int, T_VoxelContact> cells;
+    std::set<long int> collidingVoxels;
     for(std::size_t index=0; index<cResult.numContacts(); ++index)
     {
         const Contact& contact = cResult.getContact(index);
-        //hppDout(notice,"contact b1 = "<<contact.b1);
-        if(std::find(visited.begin(), visited.end(), contact.b1) == visited.end())
-            visited.push_back(contact.b1);
-        //verifying that position is theoritically reachable from next position
+        if(collidingVoxels.find(contact.b1) != collidingVoxels.end())
+            continue;
+        voxelIt = sc.samplesInVoxels_.find(contact.b1);
+        if(voxelIt == sc.samplesInVoxels_.end())
         {
-            voxelIt = sc.samplesInVoxels_.find(contact.b1);
-            if(voxelIt != sc.samplesInVoxels_.end()){
-              const VoxelSampleId& voxelSampleIds = voxelIt->second;
-              //hppDout(notice,"voxel first = "<<voxelSampleIds.first);
-              //hppDout(notice,"voxel second = "<<voxelSampleIds.second);
-              totalSamples += (int)voxelSampleIds.second;
-              for(T_Sample::const_iterator sit = sc.samples_.begin()+ voxelSampleIds.first;
-                  sit != sc.samples_.begin()+ voxelSampleIds.first + voxelSampleIds.second; ++sit)
-              {
-                  //find normal id
-                  assert(contact.o2->getObjectType() == fcl::OT_BVH); // only works with meshes
-                  const fcl::BVHModel<fcl::OBBRSS>* surface = static_cast<const fcl::BVHModel<fcl::OBBRSS>*> (contact.o2);
-                  fcl::Vec3f normal;
-                  const fcl::Triangle& tr = surface->tri_indices[contact.b2];
-                  const fcl::Vec3f& v1 = surface->vertices[tr[0]];
-                  const fcl::Vec3f& v2 = surface->vertices[tr[1]];
-                  const fcl::Vec3f& v3 = surface->vertices[tr[2]];
-                  normal = (v2 - v1).cross(v3 - v1);
-                  normal.normalize();
-                  Eigen::Vector3d eNormal(normal[0], normal[1], normal[2]);
-                  /*hppDout(notice,"sample normal : "<<eNormal.transpose());
-                  hppDout(notice,"sample contact tri = "<<contact.b2);
-                  hppDout(notice,"sample contact position = "<<contact.pos);
-                  hppDout(notice,"sample id "<<sit->id_);
-                  hppDout(notice,"sample id OK");
-                  */
-                  OctreeReport report(&(*sit), contact, evaluate ? ((*evaluate)(*sit, eDir, eNormal, params)) :0, eNormal);
-                  ++okay;
-                  reports.insert(report);
-              }
-            }else
-              hppDout(warning,"no voxels in specified triangle : "<<contact.b1);
+            hppDout(warning,"no voxels in specified triangle : "<<contact.b1);
+            continue;
+        }
+        VoxelContact voxelContact;
+        voxelContact.contact_ = &contact;
+        voxelContact.normal_ = &normals[contact.b2];
+        voxelContact.next_ = voxelIt->second.first;
+        voxelContact.end_ = voxelIt->second.first + voxelIt->second.second;
+        if(filter)
+        {
+            const Eigen::Vector3d& eNormal = *voxelContact.normal_;
+            voxelContact.localNormal_ = treeRotation * fcl::Vec3f(eNormal[0], eNormal[1], eNormal[2]);
+            if(!(filter->voxelBins(contact.b1) & filter->acceptedBins(voxelContact.localNormal_, maxAngle)))
+                continue;
+        }
+        if(!evaluateNext(sc, voxelContact, filter, cosMaxAngle, evaluate, eDir, params))
+            continue;
+        collidingVoxels.insert(contact.b1);
+        long int cellId = contact.b1;
+        if(coarseVoxels)
+        {
+            T_CoarseVoxel::const_iterator cit = coarseVoxels->find(contact.b1);
+            if(cit != coarseVoxels->end())
+                cellId = cit->second;
+        }
+        cells[cellId].push_back(voxelContact);
+    }
+    // visit the coarse voxels by decreasing value of their best sample
+    std::vector<std::pair<double, T_VoxelContact*> > order;
+    for(std::map<long int, T_VoxelContact>::iterator it = cells.begin(); it != cells.end(); ++it)
+        order.push_back(std::make_pair(-bestContact(it->second)->value_, &(it->second)));
+    std::stable_sort(order.begin(), order.end(), less_first());
+    // then take the best remaining sample of each coarse voxel in turn. Each sample
+    // returned costs at most one evaluation, plus one per colliding voxel
+    std::size_t nbSamples = 0;
+    bool remaining = true;
+    while(remaining && nbSamples < sampleBudget)
+    {
+        remaining = false;
+        for(std::vector<std::pair<double, T_VoxelContact*> >::iterator it = order.begin();
+            it != order.end() && nbSamples < sampleBudget; ++it)
+        {
+            VoxelContact* best = bestContact(*(it->second));
+            if(!best)
+                continue;
+            remaining = true;
+            const Sample& sample = sc.samples_[best->next_++];
+            reports.insert(OctreeReport(&sample, *best->contact_, evaluate ? best->value_ : 0, *best->normal_));
+            ++nbSamples;
+            evaluateNext(sc, *best, filter, cosMaxAngle, evaluate, eDir, params);
         }
     }
     return !reports.empty();
 }
 
-
 rbprm::sampling::T_OctreeReport rbprm::sampling::GetCandidates(const SampleDB& sc, const fcl::Transform3f& treeTrf,
                                                                const hpp::model::CollisionObjectPtr_t& o2,
                                                                const fcl::Vec3f& direction, const HeuristicParam & params, const heuristic evaluate)
@@ -302,9 +846,9 @@ void writeSample(const Sample& sample, std::ostream& output)
     output << std::endl;
     writeMatrix(sample.configuration_,output);
     output << std::endl;
-    writeMatrix(sample.jacobian_,output);
+    writeMatrix(sample.jacobian_.cast<double>(),output);
     output << std::endl;
-    writeMatrix(sample.jacobianProduct_,output);
+    writeMatrix(sample.jacobianProduct_.cast<double>(),output);
     output << std::endl;
 }
 
@@ -400,3 +944,388 @@ SampleDB::SampleDB(std::ifstream& myfile, bool loadValues)
     boxes_ = generateBoxesFromOctomap(octomapTree_, octree_);
     alignSampleOrderWithOctree(*this);
 }
+
+namespace
+{
+    const char binaryMagic[8] = {'R','B','P','R','M','D','B','\0'};
+    // version 1: samples, values and voxel index
+    // version 2: adds the octree and the voxel bounding boxes
+    const uint32_t binaryVersion = 2;
+    // databases are aligned on cache lines in the file, so that the packed
+    // arrays can be read directly from a mapped buffer
+    const std::size_t binaryAlignment = 64;
+    const std::size_t valueNameSize = 64;
+
+    struct BinaryDBHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t headerSize;
+        uint64_t nbSamples;
+        uint64_t startRank;
+        uint64_t configSize;
+        uint64_t jacobianCols;
+        uint64_t nbValues;
+        uint64_t nbVoxels;
+        double resolution;
+        // offsets are relative to the beginning of the header
+        uint64_t samplesOffset;
+        uint64_t valuesOffset;
+        uint64_t voxelsOffset;
+        uint64_t totalSize;
+        // version 2
+        uint64_t nbBoxes;
+        uint64_t boxesOffset;
+        uint64_t octreeOffset;
+        uint64_t octreeSize;
+    };
+
+    /// A packed sample is followed by configSize doubles for the configuration,
+    /// 6 * jacobianCols doubles for the jacobian (column major) and
+    /// 36 doubles for the jacobian product.
+    struct PackedSample
+    {
+        uint64_t id;
+        double staticValue;
+        double effectorPosition[3];
+    };
+
+    struct PackedValue
+    {
+        char name[valueNameSize];
+        double min;
+        double max;
+        // followed by nbSamples doubles
+    };
+
+    /// Voxels are identified by their octomap key, since the ids used in
+    /// samplesInVoxels_ are offsets to the octree root in memory, and are
+    /// thus only valid for a given instance of the octree.
+    struct PackedVoxel
+    {
+        uint16_t key[4];
+        uint64_t first;
+        uint64_t count;
+    };
+
+    struct PackedBox
+    {
+        uint16_t key[4];
+        double center[3];
+        double size;
+        double cost;
+        double threshold;
+    };
+
+    std::size_t alignOffset(const std::size_t offset)
+    {
+        return (offset + binaryAlignment - 1) & ~(binaryAlignment - 1);
+    }
+
+    std::size_t sampleStride(const BinaryDBHeader& header)
+    {
+        return sizeof(PackedSample) + sizeof(double) * (header.configSize + 6 * header.jacobianCols + 36);
+    }
+
+    std::size_t valueStride(const BinaryDBHeader& header)
+    {
+        return sizeof(PackedValue) + sizeof(double) * header.nbSamples;
+    }
+
+    /// \return whether count items of itemSize bytes, starting at offset, fit in
+    /// a database of totalSize bytes. Computed without overflows, for corrupted headers.
+    bool sectionFits(const uint64_t offset, const uint64_t count, const uint64_t itemSize, const uint64_t totalSize)
+    {
+        if(offset > totalSize || offset % sizeof(double) != 0)
+            return false;
+        return itemSize == 0 || count <= (totalSize - offset) / itemSize;
+    }
+
+    /// \return whether all the sections described by the header are within the database.
+    /// The dimensions are checked first, so that the strides can not overflow.
+    bool validSections(const BinaryDBHeader& header, const bool hasOctree)
+    {
+        const uint64_t maxDoubles = header.totalSize / sizeof(double);
+        if(header.nbSamples > maxDoubles || header.configSize > maxDoubles || header.jacobianCols > maxDoubles)
+            return false;
+        if(!sectionFits(header.samplesOffset, header.nbSamples, sampleStride(header), header.totalSize)
+                || !sectionFits(header.valuesOffset, header.nbValues, valueStride(header), header.totalSize)
+                || !sectionFits(header.voxelsOffset, header.nbVoxels, sizeof(PackedVoxel), header.totalSize))
+            return false;
+        return !hasOctree || (sectionFits(header.boxesOffset, header.nbBoxes, sizeof(PackedBox), header.totalSize)
+                              && header.octreeOffset <= header.totalSize
+                              && header.octreeSize <= header.totalSize - header.octreeOffset);
+    }
+
+    void writePadding(std::ostream& output, const std::size_t size)
+    {
+        const char zeros[binaryAlignment] = {0};
+        output.write(zeros, (std::streamsize)(size));
+    }
+
+    template<typename T>
+    void writeRaw(std::ostream& output, const T& data)
+    {
+        output.write(reinterpret_cast<const char*>(&data), sizeof(T));
+    }
+
+    void writeRaw(std::ostream& output, const double* data, const std::size_t size)
+    {
+        output.write(reinterpret_cast<const char*>(data), (std::streamsize)(sizeof(double) * size));
+    }
+
+    /// Read only memory mapping of a file, released on destruction.
+    struct MappedFile
+    {
+        MappedFile(const std::string& fileName)
+            : data_(0)
+            , size_(0)
+        {
+            int fd = open(fileName.c_str(), O_RDONLY);
+            if(fd < 0)
+                throw std::runtime_error ("Impossible to open database " + fileName);
+            struct stat st;
+            if(fstat(fd, &st) != 0 || st.st_size == 0)
+            {
+                close(fd);
+                throw std::runtime_error ("Impossible to read database " + fileName);
+            }
+            size_ = (std::size_t)(st.st_size);
+            void* data = mmap(0, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if(data == MAP_FAILED)
+                throw std::runtime_error ("Impossible to map database " + fileName);
+            data_ = static_cast<const char*>(data);
+        }
+
+        ~MappedFile()
+        {
+            munmap(const_cast<char*>(data_), size_);
+        }
+
+        const char* data_;
+        std::size_t size_;
+
+    private:
+        MappedFile(const MappedFile&);
+        MappedFile& operator=(const MappedFile&);
+    };
+
+    /// Read only stream buffer over a memory area, used to
+    /// deserialize the octree directly from the mapped file.
+    struct MemoryBuffer : public std::streambuf
+    {
+        MemoryBuffer(const char* data, const std::size_t size)
+        {
+            char* begin = const_cast<char*>(data);
+            setg(begin, begin, begin + size);
+        }
+    };
+
+    void packKey(const octomap::OcTreeKey& key, uint16_t packed[4])
+    {
+        for(int i = 0; i < 3; ++i)
+            packed[i] = key[i];
+        packed[3] = 0;
+    }
+
+    long int voxelId(const boost::shared_ptr<const octomap::OcTree>& octTree, const uint16_t packed[4])
+    {
+        return octTree->search(octomap::OcTreeKey(packed[0], packed[1], packed[2])) - octTree->getRoot();
+    }
+}
+
+bool hpp::rbprm::sampling::saveLimbDatabaseBinary(const SampleDB& database, std::ofstream& fp)
+{
+    const T_Sample& samples = database.samples_;
+    BinaryDBHeader header;
+    std::memset(&header, 0, sizeof(BinaryDBHeader));
+    std::memcpy(header.magic, binaryMagic, sizeof(binaryMagic));
+    header.version = binaryVersion;
+    header.headerSize = sizeof(BinaryDBHeader);
+    header.nbSamples = samples.size();
+    header.startRank = samples.empty() ? 0 : samples.front().startRank_;
+    header.configSize = samples.empty() ? 0 : samples.front().length_;
+    header.jacobianCols = samples.empty() ? 0 : samples.front().jacobian_.cols();
+    header.nbValues = database.values_.size();
+    header.nbVoxels = database.samplesInVoxels_.size();
+    header.resolution = database.resolution_;
+    header.samplesOffset = alignOffset(sizeof(BinaryDBHeader));
+    header.valuesOffset  = alignOffset(header.samplesOffset + header.nbSamples * sampleStride(header));
+    header.voxelsOffset  = alignOffset(header.valuesOffset  + header.nbValues  * valueStride(header));
+    std::ostringstream octreeData;
+    database.octomapTree_->writeData(octreeData);
+    const std::string octree = octreeData.str();
+    header.nbBoxes       = database.boxes_.size();
+    header.boxesOffset   = alignOffset(header.voxelsOffset + header.nbVoxels * sizeof(PackedVoxel));
+    header.octreeOffset  = alignOffset(header.boxesOffset  + header.nbBoxes  * sizeof(PackedBox));
+    header.octreeSize    = octree.size();
+    header.totalSize     = header.octreeOffset + header.octreeSize;
+
+    // align database start in file
+    const std::size_t start = (std::size_t)(fp.tellp());
+    writePadding(fp, alignOffset(start) - start);
+
+    writeRaw(fp, header);
+    writePadding(fp, header.samplesOffset - sizeof(BinaryDBHeader));
+    for(T_Sample::const_iterator cit = samples.begin(); cit != samples.end(); ++cit)
+    {
+        if((uint64_t)cit->configuration_.rows() != header.configSize || (uint64_t)cit->jacobian_.cols() != header.jacobianCols)
+            throw std::runtime_error ("Impossible to save binary database: samples do not have the same dimension");
+        PackedSample packed;
+        packed.id = cit->id_;
+        packed.staticValue = cit->staticValue_;
+        for(int i = 0; i < 3; ++i)
+            packed.effectorPosition[i] = cit->effectorPosition_[i];
+        writeRaw(fp, packed);
+        writeRaw(fp, cit->configuration_.data(), header.configSize);
+        // the file format stores the jacobians in double precision
+        const Eigen::MatrixXd jacobian = cit->jacobian_.cast<double>();
+        const Eigen::Matrix <model::value_type, 6, 6> jacobianProduct = cit->jacobianProduct_.cast<double>();
+        writeRaw(fp, jacobian.data(), 6 * header.jacobianCols);
+        writeRaw(fp, jacobianProduct.data(), 36);
+    }
+    std::size_t current = header.samplesOffset + header.nbSamples * sampleStride(header);
+    writePadding(fp, header.valuesOffset - current);
+    for(T_Values::const_iterator cit = database.values_.begin(); cit != database.values_.end(); ++cit)
+    {
+        if(cit->first.size() >= valueNameSize)
+            throw std::runtime_error ("Impossible to save binary database: value name too long " + cit->first);
+        PackedValue packed;
+        std::memset(&packed, 0, sizeof(PackedValue));
+        std::memcpy(packed.name, cit->first.c_str(), cit->first.size());
+        T_ValueBound::const_iterator bit = database.valueBounds_.find(cit->first);
+        if(bit != database.valueBounds_.end())
+        {
+            packed.min = bit->second.first;
+            packed.max = bit->second.second;
+        }
+        if(cit->second.size() != header.nbSamples)
+            throw std::runtime_error ("Impossible to save binary database: wrong number of values for " + cit->first);
+        writeRaw(fp, packed);
+        if(!cit->second.empty())
+            writeRaw(fp, &cit->second[0], cit->second.size());
+    }
+    current = header.valuesOffset + header.nbValues * valueStride(header);
+    writePadding(fp, header.voxelsOffset - current);
+    for(T_VoxelSampleId::const_iterator cit = database.samplesInVoxels_.begin(); cit != database.samplesInVoxels_.end(); ++cit)
+    {
+        const fcl::Vec3f& position = samples[cit->second.first].effectorPosition_;
+        PackedVoxel packed;
+        packKey(database.octomapTree_->coordToKey(position[0], position[1], position[2]), packed.key);
+        packed.first = cit->second.first;
+        packed.count = cit->second.second;
+        writeRaw(fp, packed);
+    }
+    current = header.voxelsOffset + header.nbVoxels * sizeof(PackedVoxel);
+    writePadding(fp, header.boxesOffset - current);
+    for(std::map<std::size_t, fcl::CollisionObject*>::const_iterator cit = database.boxes_.begin(); cit != database.boxes_.end(); ++cit)
+    {
+        const fcl::CollisionObject* obj = cit->second;
+        const fcl::Box* box = static_cast<const fcl::Box*>(obj->collisionGeometry().get());
+        const fcl::Vec3f& center = obj->getTranslation();
+        PackedBox packed;
+        packKey(database.octomapTree_->coordToKey(center[0], center[1], center[2]), packed.key);
+        for(int i = 0; i < 3; ++i)
+            packed.center[i] = center[i];
+        packed.size = box->side[0];
+        packed.cost = box->cost_density;
+        packed.threshold = box->threshold_occupied;
+        writeRaw(fp, packed);
+    }
+    current = header.boxesOffset + header.nbBoxes * sizeof(PackedBox);
+    writePadding(fp, header.octreeOffset - current);
+    fp.write(octree.data(), (std::streamsize)(octree.size()));
+    return fp.good();
+}
+
+SampleDB::SampleDB(const std::string& fileName, const std::size_t offset, bool loadValues)
+    : treeObject_(boost::shared_ptr<CollisionGeometry> (new fcl::Box (1, 1, 1)))
+{
+    MappedFile file(fileName);
+    const std::size_t start = alignOffset(offset);
+    if(start + sizeof(BinaryDBHeader) > file.size_)
+        throw std::runtime_error ("Impossible to load binary database: file is too short " + fileName);
+    const char* data = file.data_ + start;
+    // older versions have a shorter header, missing fields are left to 0
+    BinaryDBHeader header;
+    std::memset(&header, 0, sizeof(BinaryDBHeader));
+    std::memcpy(&header, data, std::min(sizeof(BinaryDBHeader), (std::size_t)(reinterpret_cast<const BinaryDBHeader*>(data)->headerSize)));
+    if(std::memcmp(header.magic, binaryMagic, sizeof(binaryMagic)) != 0)
+        throw std::runtime_error ("Impossible to load binary database: wrong file format " + fileName);
+    if(header.version == 0 || header.version > binaryVersion)
+        throw std::runtime_error ("Impossible to load binary database: unsupported version " + fileName);
+    if(header.totalSize > file.size_ - start)
+        throw std::runtime_error ("Impossible to load binary database: file is truncated " + fileName);
+    const bool hasOctree = header.version >= 2 && header.octreeSize > 0;
+    if(!validSections(header, hasOctree))
+        throw std::runtime_error ("Impossible to load binary database: corrupted header " + fileName);
+    const PackedVoxel* voxels = reinterpret_cast<const PackedVoxel*>(data + header.voxelsOffset);
+    for(const PackedVoxel* vit = voxels; vit != voxels + header.nbVoxels; ++vit)
+        if(vit->first > header.nbSamples || vit->count > header.nbSamples - vit->first)
+            throw std::runtime_error ("Impossible to load binary database: corrupted voxel index " + fileName);
+    resolution_ = header.resolution;
+
+    const std::size_t configSize = header.configSize, jacobianCols = header.jacobianCols;
+    const std::size_t stride = sampleStride(header);
+    samples_.reserve(header.nbSamples);
+    for(const char* current = data + header.samplesOffset;
+        current != data + header.samplesOffset + header.nbSamples * stride; current += stride)
+    {
+        const PackedSample& packed = *reinterpret_cast<const PackedSample*>(current);
+        const double* conf = reinterpret_cast<const double*>(current + sizeof(PackedSample));
+        const double* jac  = conf + configSize;
+        const double* prod = jac + 6 * jacobianCols;
+        samples_.push_back(Sample(packed.id, configSize, header.startRank, packed.staticValue,
+                                  fcl::Vec3f(packed.effectorPosition[0], packed.effectorPosition[1], packed.effectorPosition[2]),
+                                  Eigen::Map<const Eigen::VectorXd>(conf, configSize),
+                                  Eigen::Map<const Eigen::MatrixXd>(jac, 6, jacobianCols),
+                                  Eigen::Map<const Eigen::Matrix <model::value_type, 6, 6> >(prod)));
+    }
+    if(loadValues)
+    {
+        const std::size_t vStride = valueStride(header);
+        for(const char* current = data + header.valuesOffset;
+            current != data + header.valuesOffset + header.nbValues * vStride; current += vStride)
+        {
+            const PackedValue& packed = *reinterpret_cast<const PackedValue*>(current);
+            const double* vals = reinterpret_cast<const double*>(current + sizeof(PackedValue));
+            const std::string name(packed.name, strnlen(packed.name, valueNameSize));
+            values_.insert(std::make_pair(name, T_Double(vals, vals + header.nbSamples)));
+            valueBounds_.insert(std::make_pair(name, std::make_pair(packed.min, packed.max)));
+        }
+    }
+    if(hasOctree)
+    {
+        octomap::OcTree* octTree = new octomap::OcTree(resolution_);
+        MemoryBuffer buffer(data + header.octreeOffset, header.octreeSize);
+        std::istream octreeStream(&buffer);
+        octTree->readData(octreeStream);
+        octomapTree_ = boost::shared_ptr<const octomap::OcTree>(octTree);
+    }
+    else
+        octomapTree_ = boost::shared_ptr<const octomap::OcTree>(generateOctree(samples_, resolution_));
+    octree_ = new fcl::OcTree(octomapTree_);
+    geometry_ = boost::shared_ptr<fcl::CollisionGeometry>(octree_);
+    treeObject_ = fcl::CollisionObject(geometry_);
+    if(hasOctree)
+    {
+        const PackedBox* boxes = reinterpret_cast<const PackedBox*>(data + header.boxesOffset);
+        for(const PackedBox* bit = boxes; bit != boxes + header.nbBoxes; ++bit)
+        {
+            Box* box = new Box(bit->size, bit->size, bit->size);
+            box->cost_density = bit->cost;
+            box->threshold_occupied = bit->threshold;
+            fcl::CollisionObject* obj = new fcl::CollisionObject(boost::shared_ptr<fcl::CollisionGeometry>(box),
+                                                                 Transform3f(Vec3f(bit->center[0], bit->center[1], bit->center[2])));
+            boxes_.insert(std::make_pair((std::size_t)voxelId(octomapTree_, bit->key), obj));
+        }
+    }
+    else
+        boxes_ = generateBoxesFromOctomap(octomapTree_, octree_);
+    // samples are stored aligned with the octree, only voxel ids must be recomputed
+    // for the current instance of the octree
+    for(const PackedVoxel* vit = voxels; vit != voxels + header.nbVoxels; ++vit)
+        samplesInVoxels_.insert(std::make_pair(voxelId(octomapTree_, vit->key), std::make_pair((std::size_t)vit->first, (std::size_t)vit->count)));
+    computeCoarseVoxels(*this);
+}
@@ -15,10 +15,14 @@
 // hpp-rbprm. If not, see <http://www.gnu.org/licenses/>.
 
 #include <hpp/rbprm/sampling/sample.hh>
+#include <hpp/rbprm/random.hh>
 #include <hpp/model/joint.hh>
 #include <hpp/model/joint-configuration.hh>
 
 #include <Eigen/Eigen>
+#include <omp.h>
+#include <cmath>
+#include <stdexcept>
 
 using namespace hpp;
 using namespace hpp::model;
@@ -55,17 +59,24 @@ double Manipulability(const Eigen::MatrixXd& product)
     return det > 0 ? sqrt(det) : 0;
 }
 
+/// Stores the jacobian of a sample and its product in single precision, and
+/// sets its static value to the manipulability computed in double precision
+void StoreJacobian(Sample& sample, const Eigen::MatrixXd& jacobian)
+{
+    const Eigen::MatrixXd product = jacobian * jacobian.transpose();
+    sample.jacobian_ = jacobian.cast<float>();
+    sample.jacobianProduct_ = product.cast<float>();
+    sample.staticValue_ = Manipulability(product);
+}
+
 Sample::Sample(const model::JointPtr_t limb, const model::JointPtr_t effector, const fcl::Vec3f& offset, std::size_t id)
     : startRank_(limb->rankInConfiguration())
     , length_ (ComputeLength(limb, effector))
     , configuration_ (limb->robot()->currentConfiguration().segment(startRank_, length_))
     , effectorPosition_(ComputeEffectorPosition(limb, effector,offset))
-    , jacobian_(Jacobian(limb, effector))
-    , jacobianProduct_(jacobian_*jacobian_.transpose())
     , id_(id)
-    , staticValue_(Manipulability(jacobianProduct_))
 {
-    // NOTHING
+    StoreJacobian(*this, Jacobian(limb, effector));
 }
 
 Sample::Sample(const std::size_t id, const std::size_t length, const std::size_t startRank, const double staticValue,
@@ -75,8 +86,8 @@ Sample::Sample(const std::size_t id, const std::size_t length, const std::size_t
     , length_ (length)
     , configuration_ (configuration)
     , effectorPosition_(effectorPosition)
-    , jacobian_(jacobian)
-    , jacobianProduct_(jacobianProduct)
+    , jacobian_(jacobian.cast<float>())
+    , jacobianProduct_(jacobianProduct.cast<float>())
     , id_(id)
     , staticValue_(staticValue)
 {
@@ -88,12 +99,9 @@ Sample::Sample(const model::JointPtr_t limb, const model::JointPtr_t effector, m
     , length_ (ComputeLength(limb, effector))
     , configuration_ (configuration)
     , effectorPosition_(ComputeEffectorPosition(limb,effector,offset))
-    , jacobian_(Jacobian(limb,effector))
-    , jacobianProduct_(jacobian_*jacobian_.transpose())
     , id_(id)
-    , staticValue_(Manipulability(jacobianProduct_))
 {
-    // NOTHING
+    StoreJacobian(*this, Jacobian(limb,effector));
 }
 
 Sample::Sample(const Sample &clone)
@@ -110,33 +118,116 @@ Sample::Sample(const Sample &clone)
     // NOTHING
 }
 
+Eigen::MatrixXd hpp::rbprm::sampling::ComputeJacobian(const model::JointPtr_t limb, const model::JointPtr_t effector, const Sample& sample)
+{
+    DevicePtr_t robot = limb->robot();
+    Configuration_t configuration = robot->currentConfiguration();
+    Load(sample, configuration);
+    robot->currentConfiguration(configuration);
+    robot->computeForwardKinematics();
+    return Jacobian(limb, effector);
+}
+
 void hpp::rbprm::sampling::Load(const Sample& sample, ConfigurationOut_t configuration)
 {
     configuration.segment(sample.startRank_, sample.length_) = sample.configuration_;
 }
 
+namespace
+{
+    /// Throws if a joint of the limb cannot be uniformly sampled, since
+    /// exceptions must not leave the parallel region of GenerateSamples
+    void checkSampleable(const model::JointPtr_t limb)
+    {
+        for(Joint* current = limb; current; current = current->numberChildJoints() != 0 ? current->childJoint(0) : 0)
+        {
+            if(dynamic_cast<const JointSO3*>(current) || dynamic_cast<const jointRotation::Bounded*>(current)
+                    || dynamic_cast<const jointRotation::UnBounded*>(current))
+                continue;
+            for(std::size_t i = 0; i < current->configSize(); ++i)
+                if(!current->configuration()->isBounded(i))
+                    throw std::runtime_error ("Cannot uniformly sample non bounded degrees of freedom of joint " + current->name());
+        }
+    }
+}
+
+void hpp::rbprm::sampling::UniformlySample(const model::JointPtr_t joint, ConfigurationOut_t config, RandomGenerator& rng)
+{
+    const std::size_t rank = joint->rankInConfiguration();
+    if(dynamic_cast<const JointSO3*>(joint))
+    {
+        // unit quaternion, Shoemake's method
+        const double u1 = rng.uniform(), u2 = rng.uniform(0, 2*M_PI), u3 = rng.uniform(0, 2*M_PI);
+        const double a = sqrt(1 - u1), b = sqrt(u1);
+        config[rank]   = a * sin(u2);
+        config[rank+1] = a * cos(u2);
+        config[rank+2] = b * sin(u3);
+        config[rank+3] = b * cos(u3);
+        return;
+    }
+    if(dynamic_cast<const jointRotation::UnBounded*>(joint))
+    {
+        // the configuration is the cosine and sine of the angle
+        const double angle = rng.uniform(-M_PI, M_PI);
+        config[rank]   = cos(angle);
+        config[rank+1] = sin(angle);
+        return;
+    }
+    const JointConfiguration* jointConfig = joint->configuration();
+    const bool rotation = dynamic_cast<const jointRotation::Bounded*>(joint) != 0;
+    for(std::size_t i = 0; i < joint->configSize(); ++i)
+    {
+        if(jointConfig->isBounded(i))
+            config[rank+i] = rng.uniform(jointConfig->lowerBound(i), jointConfig->upperBound(i));
+        else if(rotation)
+            config[rank+i] = rng.uniform(-M_PI, M_PI);
+    }
+}
+
 hpp::rbprm::sampling::SampleVector_t hpp::rbprm::sampling::GenerateSamples(const model::JointPtr_t model, const std::string& effector
-                                                         , const std::size_t nbSamples, const fcl::Vec3f& offset)
+                                                         , const std::size_t nbSamples, const fcl::Vec3f& offset, const unsigned long long seed)
 {
-    SampleVector_t result; result.reserve(nbSamples);
-    model::DevicePtr_t device (model->robot()->clone());
-    Configuration_t config = device->currentConfiguration();
-    JointPtr_t clone = device->getJointByName(model->name());
-    JointPtr_t effectorClone = device->getJointByName(effector);
-    std::size_t startRank_(model->rankInConfiguration());
-    std::size_t length_ (ComputeLength(model, effectorClone));
-    for(std::size_t i = 0; i< nbSamples; ++i)
+    checkSampleable(model);
+    std::vector<SampleVector_t> threadResults;
+    #pragma omp parallel
     {
-        clone->configuration ()->uniformlySample (clone->rankInConfiguration (), config);
-        Joint* current = clone;
-        while(current->numberChildJoints() !=0)
+        model::DevicePtr_t device;
+        #pragma omp critical
+        {
+            device = model->robot()->clone();
+        }
+        #pragma omp single
         {
-            current = current->childJoint(0);
-            current->configuration ()->uniformlySample (current->rankInConfiguration(), config);
+            threadResults.resize(omp_get_num_threads());
+        }
+        Configuration_t config = device->currentConfiguration();
+        JointPtr_t clone = device->getJointByName(model->name());
+        JointPtr_t effectorClone = device->getJointByName(effector);
+        std::size_t startRank_(model->rankInConfiguration());
+        std::size_t length_ (ComputeLength(model, effectorClone));
+        SampleVector_t& result = threadResults[omp_get_thread_num()];
+        // static scheduling assigns contiguous chunks of ids to threads in increasing order,
+        // so concatenating the per thread results preserves the sample ids order.
+        #pragma omp for schedule(static)
+        for(long i = 0; i < (long)nbSamples; ++i)
+        {
+            // each sample owns a stream, so that the samples do not depend on the number of threads
+            RandomGenerator rng;
+            rng.seed(seed, (boost::uint64_t)i);
+            UniformlySample(clone, config, rng);
+            Joint* current = clone;
+            while(current->numberChildJoints() !=0)
+            {
+                current = current->childJoint(0);
+                UniformlySample(current, config, rng);
+            }
+            device->currentConfiguration (config);
+            device->computeForwardKinematics();
+            result.push_back(Sample(clone, effectorClone, config.segment(startRank_, length_), offset, (std::size_t)i));
         }
-        device->currentConfiguration (config);
-        device->computeForwardKinematics();
-        result.push_back(Sample(clone, effectorClone, config.segment(startRank_, length_), offset, i));
     }
+    SampleVector_t result; result.reserve(nbSamples);
+    for(std::vector<SampleVector_t>::const_iterator cit = threadResults.begin(); cit != threadResults.end(); ++cit)
+        result.insert(result.end(), cit->begin(), cit->end());
     return result;
 }
@@ -19,6 +19,8 @@
 
 #include "test-tools.hh"
 #include "hpp/rbprm/contact_generation/contact_generation.hh"
+#include "hpp/rbprm/contact_generation/work-stealing.hh"
+#include "hpp/rbprm/interpolation/contact-cache.hh"
 
 #define BOOST_TEST_MODULE test-fullbody
 #include <boost/test/included/unit_test.hpp>
@@ -117,6 +119,50 @@ BOOST_AUTO_TEST_CASE (gen_combinatorial) {
 
 }
 
+struct FirstSuccessTask
+{
+    FirstSuccessTask(const std::size_t nbTasks) : run_(nbTasks, 0) {}
+    bool operator()(const std::size_t task, const std::size_t /*worker*/)
+    {
+        run_[task] = 1;
+        return task == 37 || task == 80 || task % 53 == 52;
+    }
+    std::vector<int> run_; // not vector<bool>, written concurrently
+};
+
+BOOST_AUTO_TEST_CASE (firstSuccess) {
+    for(std::size_t nbWorkers = 1; nbWorkers < 8; ++nbWorkers)
+    {
+        FirstSuccessTask task(100);
+        BOOST_CHECK_EQUAL(findFirstSuccess(task, 100, nbWorkers), (std::size_t)37);
+        for(std::size_t i = 0; i <= 37; ++i)
+            BOOST_CHECK_MESSAGE(task.run_[i], "Tasks before the first success must be run");
+    }
+    FirstSuccessTask task(10);
+    BOOST_CHECK_EQUAL(findFirstSuccess(task, 10, 4), (std::size_t)10);
+}
+
+BOOST_AUTO_TEST_CASE (contactCacheKeys) {
+    // lookups do not need the robot
+    interpolation::ContactCachePtr_t cache = interpolation::ContactCache::create(RbPrmFullBodyPtr_t(), 0.01, 0.01);
+    State previous;
+    AddToState("c1", previous);
+    AddToState("c2", previous);
+    Configuration_t configuration(7); configuration << 0.005, 0.005, 1.005, 1, 0, 0, 0;
+    contact::ContactReport report;
+    report.success_ = true;
+    cache->insert(previous, configuration, 0., report);
+    Configuration_t nearby(configuration); nearby[0] += 0.001; nearby.segment<4>(3) = -nearby.segment<4>(3);
+    BOOST_CHECK_MESSAGE(cache->find(previous, nearby, 0.), "nearby root poses share a cell");
+    Configuration_t far(configuration); far[0] += 0.01;
+    BOOST_CHECK_MESSAGE(!cache->find(previous, far, 0.), "root positions in different cells must not match");
+    BOOST_CHECK_MESSAGE(!cache->find(previous, configuration, 0.5), "robustness is part of the request");
+    State moved(previous);
+    moved.contactPositions_["c1"] = fcl::Vec3f(0,0,1e-6);
+    BOOST_CHECK_MESSAGE(!cache->find(moved, configuration, 0.), "previous contacts are compared exactly");
+    BOOST_CHECK_EQUAL(cache->size(), (std::size_t)1);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 
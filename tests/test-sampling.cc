@@ -18,9 +18,22 @@
 
 #include "test-tools.hh"
 #include <hpp/rbprm/sampling/sample-db.hh>
+#include <hpp/rbprm/sampling/sample-db-refiner.hh>
+#include <hpp/rbprm/random.hh>
+#include <hpp/rbprm/rbprm-shooter.hh>
 #include <hpp/fcl/octree.h>
 #include <hpp/fcl/distance.h>
 #include <hpp/fcl/collision.h>
+#include <boost/bind.hpp>
+
+#include <fstream>
+#include <algorithm>
+#include <set>
+#include <ctime>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <omp.h>
 
 #define BOOST_TEST_MODULE test-sampling
 #include <boost/test/included/unit_test.hpp>
@@ -48,6 +61,47 @@ BOOST_AUTO_TEST_CASE (sampleGeneration) {
     }
 }
 
+BOOST_AUTO_TEST_CASE (sampleGenerationDeterministic) {
+    DevicePtr_t robot = initDevice();
+    JointPtr_t joint = robot->getJointByName("arm");
+    const int nbThreads = omp_get_max_threads();
+    omp_set_num_threads(1);
+    SampleVector_t sequential = GenerateSamples(joint, "elbow", 1000, fcl::Vec3f(0,0,0), 42);
+    omp_set_num_threads(std::max(nbThreads, 4));
+    SampleVector_t parallel = GenerateSamples(joint, "elbow", 1000, fcl::Vec3f(0,0,0), 42);
+    omp_set_num_threads(nbThreads);
+    BOOST_CHECK_EQUAL(sequential.size(), parallel.size());
+    for(std::size_t i = 0; i < sequential.size() && i < parallel.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(parallel[i].id_, i);
+        BOOST_CHECK_MESSAGE (sequential[i].configuration_ == parallel[i].configuration_
+                             && sequential[i].jacobianProduct_ == parallel[i].jacobianProduct_,
+                             "Generated samples must not depend on the number of threads");
+    }
+}
+
+BOOST_AUTO_TEST_CASE (threadRandomStreams) {
+    const int nbThreads = 4;
+    std::vector<double> first(nbThreads), second(nbThreads);
+    SeedRandom(42);
+    #pragma omp parallel for schedule(static) num_threads(nbThreads)
+    for(int i = 0; i < nbThreads; ++i)
+        first[i] = ThreadRandom().uniform();
+    SeedRandom(42);
+    #pragma omp parallel for schedule(static) num_threads(nbThreads)
+    for(int i = 0; i < nbThreads; ++i)
+        second[i] = ThreadRandom().uniform();
+    BOOST_CHECK(first == second);
+    RandomGenerator generator;
+    for(std::size_t i = 0; i < 1000; ++i)
+    {
+        generator.seed(42, i);
+        const double value = generator.uniform();
+        BOOST_CHECK(value >= 0 && value < 1);
+        BOOST_CHECK(generator.index(7) < 7);
+    }
+}
+
 BOOST_AUTO_TEST_CASE (sampleContainerGeneration) {
     DevicePtr_t robot = initDevice();
     JointPtr_t joint = robot->getJointByName("arm");
@@ -81,6 +135,415 @@ BOOST_AUTO_TEST_CASE (octreeRequest) {
     reports = rbprm::sampling::GetCandidates(sc, toofarLocation, obstacle,fcl::Vec3f(1,0,0));
     BOOST_CHECK_MESSAGE (reports.empty(), "samples found by request");
 }
+
+BOOST_AUTO_TEST_CASE (candidateSetOrdering) {
+    CandidateSet all, best(10);
+    for(int i = 0; i < 1000; ++i)
+    {
+        OctreeReport report(0, fcl::Contact(), (double)((i * 7919) % 101), fcl::Vec3f(0,0,1));
+        all.insert(report);
+        best.insert(report);
+    }
+    BOOST_CHECK_EQUAL(all.size(), (std::size_t)1000);
+    BOOST_CHECK_EQUAL(best.size(), (std::size_t)10);
+    CandidateSet::const_iterator cit = all.begin();
+    const OctreeReport* report = best.next();
+    for(; report; report = best.next(), ++cit)
+        BOOST_CHECK_EQUAL(report->value_, cit->value_);
+    double value = std::numeric_limits<double>::max();
+    for(cit = all.begin(); cit != all.end(); ++cit)
+    {
+        BOOST_CHECK_MESSAGE (cit->value_ <= value, "candidates must be ordered by decreasing value");
+        value = cit->value_;
+    }
+}
+
+double elapsedMs(const clock_t start)
+{
+    return 1000. * (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+// wall clock time, for operations bound by input / output
+double wallElapsedMs(const double start)
+{
+    return 1000. * (omp_get_wtime() - start);
+}
+
+// unique file in the temporary directory, so that tests can run concurrently
+std::string temporaryFile(const std::string& prefix)
+{
+    std::string name("/tmp/" + prefix + "-XXXXXX");
+    std::vector<char> buffer(name.begin(), name.end());
+    buffer.push_back('\0');
+    const int fd = mkstemp(&buffer[0]);
+    BOOST_REQUIRE_MESSAGE (fd != -1, "temporary file could not be created");
+    close(fd);
+    return std::string(&buffer[0]);
+}
+
+// height of the effector for a sample, computed with the forward kinematics of device
+double effectorHeight(const DevicePtr_t device, const std::string& effector, const SampleDB& /*sampleDB*/, const Sample& sample)
+{
+    Configuration_t conf(device->currentConfiguration());
+    Load(sample, conf);
+    device->currentConfiguration(conf);
+    device->computeForwardKinematics();
+    return device->getJointByName(effector)->currentTransformation().getTranslation()[2];
+}
+
+BOOST_AUTO_TEST_CASE (getCandidatesBenchmark) {
+    CollisionObjectPtr_t terrain = MeshTerrain(4., 200);
+    DevicePtr_t robot = initDevice();
+    JointPtr_t joint = robot->getJointByName("arm");
+    SampleDB sc(joint, "elbow", 10000, fcl::Vec3f(0,0,0), 0.1);
+    HeuristicFactory factory;
+    const heuristic eval = factory.heuristics_["EFORT"];
+    HeuristicParam params;
+    model::ObjectVector_t affordances; affordances.push_back(terrain);
+    T_AffordanceNormals normals;
+    AddAffordanceNormals(affordances, normals);
+    const T_TriangleNormals& terrainNormals = normals[terrain->fcl()->collisionGeometry().get()];
+    const std::size_t nbQueries = 100;
+    std::size_t nbCandidates = 0;
+    clock_t start = clock();
+    for(std::size_t i = 0; i < nbQueries; ++i)
+    {
+        fcl::Transform3f location;
+        location.setTranslation(fcl::Vec3f(0.01 * (double)i, 0, 0.5));
+        T_OctreeReport reports;
+        GetCandidates(sc, location, terrain, fcl::Vec3f(1,0,0), reports, params, eval, 0, 2, OrientationBins(), M_PI, &terrainNormals);
+        nbCandidates += reports.size();
+    }
+    const double time = elapsedMs(start);
+    BOOST_TEST_MESSAGE ("GetCandidates on a " << 2 * 200 * 200 << " triangles terrain: " << time / (double)nbQueries
+                        << " ms per query, " << nbCandidates / nbQueries << " candidates per query");
+    BOOST_CHECK_MESSAGE (nbCandidates > 0, "No candidate found on the terrain");
+}
+
+BOOST_AUTO_TEST_CASE (weightedTriangleBenchmark) {
+    // two terrains with the same number of triangles, the second one 16 times larger
+    model::ObjectVector_t geometries;
+    geometries.push_back(MeshTerrain(1., 10));
+    geometries.push_back(MeshTerrain(4., 10, 1.));
+    TriangleTable triangles(geometries);
+    BOOST_CHECK(triangles.size() == 400);
+    RandomGenerator generator; generator.seed(0);
+    const std::size_t nbDraws = 100000;
+    std::size_t nbLarge = 0;
+    for(std::size_t i = 0; i < nbDraws; ++i)
+        if(triangles.weightedTriangle(generator) >= 200)
+            ++nbLarge;
+    BOOST_CHECK_CLOSE ((double)nbLarge / (double)nbDraws, 16. / 17., 1.);
+
+    model::ObjectVector_t large;
+    large.push_back(MeshTerrain(100., 1000));
+    clock_t start = clock();
+    TriangleTable largeTriangles(large);
+    const double initTime = elapsedMs(start);
+    const std::size_t nbShots = 1000000;
+    fcl::Vec3f sum(0,0,0);
+    start = clock();
+    for(std::size_t i = 0; i < nbShots; ++i)
+        sum += largeTriangles.samplePoint(largeTriangles.weightedTriangle(generator), generator);
+    const double time = elapsedMs(start);
+    BOOST_TEST_MESSAGE ("Weighted triangle sampling on a " << largeTriangles.size() << " triangles terrain: "
+              << (double)nbShots / time * 1000. << " shots per second (table built in " << initTime << " ms)");
+    BOOST_CHECK(std::abs(sum[2]) < 1e-6);
+}
+
+BOOST_AUTO_TEST_CASE (batchHeuristics) {
+    DevicePtr_t robot = initDevice();
+    JointPtr_t joint = robot->getJointByName("arm");
+    SampleDB sc(joint, "elbow", 1000, fcl::Vec3f(0,0,0), 0.1);
+    HeuristicFactory factory;
+    HeuristicParam params;
+    const Eigen::Vector3d direction(1,0.5,0), normal(0,0.6,0.8);
+    const char* names[] = {"static", "EFORT", "EFORT_Normal", "jointlimits"};
+    for(std::size_t h = 0; h < 4; ++h)
+    {
+        const heuristic eval = factory.heuristics_[names[h]];
+        const batchHeuristic batch = GetBatchHeuristic(eval);
+        BOOST_REQUIRE_MESSAGE (batch, "built-in heuristics must have a batch version");
+        std::vector<double> values(sc.samples_.size());
+        (*batch)(sc.samples_, 0, sc.samples_.size(), direction, normal, params, &values[0]);
+        for(std::size_t i = 0; i < sc.samples_.size(); ++i)
+        {
+            const double expected = (*eval)(sc.samples_[i], direction, normal, params);
+            BOOST_CHECK_MESSAGE (std::abs(values[i] - expected) <= 1e-9 * std::max(1., std::abs(expected)),
+                                 "batch heuristic " << names[h] << " differs from the per sample one");
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE (preparedDynamicHeuristic) {
+    DevicePtr_t robot = initDevice();
+    JointPtr_t joint = robot->getJointByName("arm");
+    SampleDB sc(joint, "elbow", 1000, fcl::Vec3f(0,0,0), 0.1);
+    HeuristicFactory factory;
+    const heuristic eval = factory.heuristics_["dynamic"];
+    HeuristicParam params;
+    params.contactPositions_["lfoot"] = fcl::Vec3f(0.13, 0.21, 0.02);
+    params.contactPositions_["rfoot"] = fcl::Vec3f(0.11, -0.19, -0.03);
+    params.contactPositions_["lhand"] = fcl::Vec3f(0.52, 0.33, 0.71);
+    params.comPosition_ = fcl::Vec3f(0.05, 0.01, 0.9);
+    params.comSpeed_ = fcl::Vec3f(0.3, -0.1, 0);
+    params.comAcceleration_ = fcl::Vec3f(0.7, 0.2, 0);
+    params.sampleLimbName_ = "arm";
+    params.tfWorldRoot_.setTranslation(fcl::Vec3f(0, 0, 0.2));
+    HeuristicParam prepared(params);
+    prepared.prepare();
+    BOOST_REQUIRE(prepared.context_ && !prepared.context_->hulls_.empty());
+    BOOST_CHECK(prepared.context_->contactNames_.size() == 3);
+    const Eigen::Vector3d direction(1,0,0), normal(0,0,1);
+    std::vector<double> values(sc.samples_.size());
+    (*GetBatchHeuristic(eval))(sc.samples_, 0, sc.samples_.size(), direction, normal, prepared, &values[0]);
+    for(std::size_t i = 0; i < sc.samples_.size(); ++i)
+    {
+        const double expected = (*eval)(sc.samples_[i], direction, normal, params);
+        BOOST_CHECK_CLOSE (expected, (*eval)(sc.samples_[i], direction, normal, prepared), 1e-6);
+        BOOST_CHECK_CLOSE (expected, values[i], 1e-6);
+    }
+}
+
+BOOST_AUTO_TEST_CASE (budgetedCandidates) {
+    CollisionObjectPtr_t terrain = MeshTerrain(4., 200);
+    DevicePtr_t robot = initDevice();
+    JointPtr_t joint = robot->getJointByName("arm");
+    SampleDB sc(joint, "elbow", 10000, fcl::Vec3f(0,0,0), 0.1);
+    BOOST_CHECK_MESSAGE (!sc.coarseVoxels_.empty(), "coarse voxels should be computed with the database");
+    HeuristicParam params;
+    fcl::Transform3f location;
+    location.setTranslation(fcl::Vec3f(0, 0, 0.5));
+    T_OctreeReport all, budgeted;
+    GetCandidates(sc, location, terrain, fcl::Vec3f(1,0,0), all, params);
+    GetCandidates(sc, location, terrain, fcl::Vec3f(1,0,0), budgeted, params, 0, 50);
+    BOOST_CHECK_MESSAGE (!budgeted.empty(), "No candidate found within the budget");
+    BOOST_CHECK(budgeted.size() <= 50);
+    std::set<std::size_t> allIds;
+    for(T_OctreeReport::const_iterator cit = all.begin(); cit != all.end(); ++cit)
+        allIds.insert(cit->sample_->id_);
+    BOOST_CHECK_EQUAL(budgeted.size(), std::min<std::size_t>(allIds.size(), 50));
+    // samples are returned once, and spread over the colliding voxels
+    HeuristicFactory factory;
+    T_OctreeReport ranked;
+    GetCandidates(sc, location, terrain, fcl::Vec3f(1,0,0), ranked, params, factory.heuristics_["EFORT"], 50);
+    const T_OctreeReport* sets[] = {&budgeted, &ranked};
+    for(std::size_t s = 0; s < 2; ++s)
+    {
+        std::set<std::size_t> ids;
+        std::set<long int> voxels;
+        for(T_OctreeReport::const_iterator cit = sets[s]->begin(); cit != sets[s]->end(); ++cit)
+        {
+            ids.insert(cit->sample_->id_);
+            const std::size_t index = (std::size_t)(cit->sample_ - &sc.samples_[0]);
+            for(T_VoxelSampleId::const_iterator vit = sc.samplesInVoxels_.begin(); vit != sc.samplesInVoxels_.end(); ++vit)
+                if(index >= vit->second.first && index < vit->second.first + vit->second.second)
+                    voxels.insert(vit->first);
+        }
+        BOOST_CHECK_EQUAL(ids.size(), sets[s]->size());
+        BOOST_CHECK_MESSAGE (voxels.size() > 1, "budgeted candidates should cover several voxels");
+    }
+}
+
+BOOST_AUTO_TEST_CASE (seededRandomHeuristics) {
+    CollisionObjectPtr_t terrain = MeshTerrain(4., 200);
+    DevicePtr_t robot = initDevice();
+    JointPtr_t joint = robot->getJointByName("arm");
+    SampleDB sc(joint, "elbow", 10000, fcl::Vec3f(0,0,0), 0.1);
+    HeuristicFactory factory;
+    const heuristic eval = factory.heuristics_["random"];
+    fcl::Transform3f location;
+    location.setTranslation(fcl::Vec3f(0, 0, 0.5));
+    // a query drawing from its own generator gives the same candidates whatever the thread running it
+    const int nbQueries = 8;
+    std::vector<std::vector<std::size_t> > ids(nbQueries);
+    #pragma omp parallel for schedule(dynamic)
+    for(int i = 0; i < nbQueries; ++i)
+    {
+        RandomGenerator generator;
+        generator.seed(42, 0);
+        HeuristicParam params;
+        params.generator_ = &generator;
+        T_OctreeReport reports;
+        GetCandidates(sc, location, terrain, fcl::Vec3f(1,0,0), reports, params, eval, 50);
+        for(T_OctreeReport::const_iterator cit = reports.begin(); cit != reports.end(); ++cit)
+            ids[i].push_back(cit->sample_->id_);
+    }
+    BOOST_CHECK(!ids[0].empty());
+    for(int i = 1; i < nbQueries; ++i)
+        BOOST_CHECK_MESSAGE (ids[i] == ids[0], "seeded queries must give the same candidates");
+}
+
+BOOST_AUTO_TEST_CASE (orientationFilter) {
+    CollisionObjectPtr_t terrain = MeshTerrain(4., 200);
+    DevicePtr_t robot = initDevice();
+    JointPtr_t joint = robot->getJointByName("arm");
+    SampleDB sc(joint, "elbow", 10000, fcl::Vec3f(0,0,0), 0.1);
+    OrientationBins bins(sc, joint, robot->getJointByName("elbow"), fcl::Vec3f(0,0,1));
+    BOOST_CHECK_EQUAL((std::size_t)bins.normals_.cols(), sc.samples_.size());
+    HeuristicParam params;
+    fcl::Transform3f location;
+    location.setTranslation(fcl::Vec3f(0, 0, 0.5));
+    T_OctreeReport all, aligned;
+    GetCandidates(sc, location, terrain, fcl::Vec3f(1,0,0), all, params);
+    GetCandidates(sc, location, terrain, fcl::Vec3f(1,0,0), aligned, params, 0, 0, 2, bins, M_PI / 4);
+    BOOST_CHECK(aligned.size() <= all.size());
+    for(T_OctreeReport::const_iterator cit = aligned.begin(); cit != aligned.end(); ++cit)
+    {
+        const Eigen::Vector3d normal = bins.normals_.col(cit->sample_->id_);
+        BOOST_CHECK_MESSAGE (normal.dot(Eigen::Vector3d(cit->normal_[0], cit->normal_[1], cit->normal_[2])) >= std::cos(M_PI / 4) - 1e-9,
+                             "samples must be aligned with the contact normal");
+    }
+}
+
+BOOST_AUTO_TEST_CASE (sampleDBRefinement) {
+    DevicePtr_t robot = initDevice();
+    JointPtr_t joint = robot->getJointByName("arm");
+    SampleDBPtr_t database(new SampleDB(joint, "elbow", 1000, fcl::Vec3f(0,0,0), 0.1));
+    const SampleDB& sc = *database;
+    SampleDBRefinerPtr_t refiner = SampleDBRefiner::create(database, joint, robot->getJointByName("elbow"),
+                                                           fcl::Vec3f(0,0,0), fcl::Vec3f(0,0,1), false);
+    BOOST_CHECK_MESSAGE (!refiner->current(), "no refined database before the first refinement");
+    BOOST_CHECK_EQUAL(refiner->refine(100), 0);
+    for(std::size_t i = 0; i < 10; ++i)
+        refiner->recordHit(sc.samples_[i]);
+    const std::size_t added = refiner->refine(100, 1, 42);
+    BOOST_CHECK_MESSAGE (added > 0, "samples should be added in the used voxels");
+    RefinedSampleDBPtr_t refined = refiner->current();
+    BOOST_REQUIRE(refined);
+    BOOST_CHECK_EQUAL(refined->database_.samples_.size(), sc.samples_.size() + added);
+    const std::string binaryFile(temporaryFile("test-sampling-refined-db"));
+    {
+        std::ofstream binary(binaryFile.c_str(), std::ios::out | std::ios::binary);
+        BOOST_CHECK_MESSAGE (saveLimbDatabaseBinary(refined->database_, binary), "refined database could not be written");
+    }
+    {
+        SampleDB fromBinary(binaryFile, 0);
+        BOOST_CHECK_EQUAL(fromBinary.samples_.size(), refined->database_.samples_.size());
+    }
+    std::remove(binaryFile.c_str());
+}
+
+BOOST_AUTO_TEST_CASE (concurrentRefinement) {
+    CollisionObjectPtr_t terrain = MeshTerrain(4., 200);
+    DevicePtr_t robot = initDevice();
+    JointPtr_t joint = robot->getJointByName("arm");
+    // the evaluations are bound to a copy of the robot, as done by AnalysisFactory::CopyEvaluations
+    T_evaluate data;
+    data.insert(std::make_pair("effectorHeight", boost::bind(&effectorHeight, robot->clone(), "elbow", _1, _2)));
+    SampleDBPtr_t database(new SampleDB(joint, "elbow", 1000, fcl::Vec3f(0,0,0), 0.1, data, "effectorHeight"));
+    SampleDBRefinerPtr_t refiner = SampleDBRefiner::create(database, joint, robot->getJointByName("elbow"),
+                                                           fcl::Vec3f(0,0,0), fcl::Vec3f(0,0,1), false, data, "effectorHeight");
+    for(std::size_t i = 0; i < database->samples_.size(); i += 10)
+        refiner->recordHit(database->samples_[i]);
+    HeuristicParam params;
+    fcl::Transform3f location;
+    location.setTranslation(fcl::Vec3f(0, 0, 0.5));
+    std::size_t added = 0;
+    bool robotUnchanged = true;
+    // contact queries use the robot of the limb while the database is refined
+    #pragma omp parallel sections num_threads(2)
+    {
+        #pragma omp section
+        {
+            added = refiner->refine(1000, 1, 42);
+        }
+        #pragma omp section
+        {
+            for(std::size_t i = 0; i < 20; ++i)
+            {
+                const RefinedSampleDBPtr_t refined = refiner->current();
+                const SampleDB& sc = refined ? refined->database_ : *database;
+                T_OctreeReport reports;
+                GetCandidates(sc, location, terrain, fcl::Vec3f(1,0,0), reports, params);
+                for(T_OctreeReport::const_iterator cit = reports.begin(); cit != reports.end(); ++cit)
+                {
+                    Configuration_t conf(robot->currentConfiguration());
+                    Load(*cit->sample_, conf);
+                    robot->currentConfiguration(conf);
+                    robot->computeForwardKinematics();
+                    robotUnchanged = robotUnchanged && robot->currentConfiguration() == conf;
+                    refiner->recordHit(*cit->sample_);
+                }
+            }
+        }
+    }
+    BOOST_CHECK_MESSAGE (robotUnchanged, "refine must not modify the robot of the limb");
+    BOOST_CHECK_MESSAGE (added > 0, "samples should be added in the used voxels");
+    RefinedSampleDBPtr_t refined = refiner->current();
+    BOOST_REQUIRE(refined);
+    // values computed during the refinement must not depend on the queries
+    DevicePtr_t check = robot->clone();
+    const SampleVector_t& samples = refined->database_.samples_;
+    for(std::size_t i = 0; i < samples.size(); ++i)
+        BOOST_CHECK_SMALL(samples[i].staticValue_ - effectorHeight(check, "elbow", refined->database_, samples[i]), 1e-9);
+}
+
+BOOST_AUTO_TEST_CASE (droppedJacobians) {
+    DevicePtr_t robot = initDevice();
+    JointPtr_t joint = robot->getJointByName("arm");
+    JointPtr_t effector = robot->getJointByName("elbow");
+    SampleDB full(joint, "elbow", 1000, fcl::Vec3f(0,0,0), 0.1);
+    SampleDB light(joint, "elbow", 1000, fcl::Vec3f(0,0,0), 0.1, T_evaluate(), "", false);
+    BOOST_CHECK(HasJacobians(full));
+    BOOST_CHECK(!HasJacobians(light));
+    BOOST_REQUIRE_EQUAL(full.samples_.size(), light.samples_.size());
+    for(std::size_t i = 0; i < full.samples_.size(); i += 100)
+    {
+        const Sample& s = full.samples_[i], & l = light.samples_[i];
+        BOOST_CHECK_MESSAGE (s.jacobianProduct_ == l.jacobianProduct_, "jacobian products must be kept");
+        BOOST_CHECK_MESSAGE (ComputeJacobian(joint, effector, l).cast<float>().isApprox(s.jacobian_), "recomputed jacobian differs from original");
+    }
+}
+
+BOOST_AUTO_TEST_CASE (binaryDatabaseLoading) {
+    DevicePtr_t robot = initDevice();
+    JointPtr_t joint = robot->getJointByName("arm");
+    SampleDB sc(joint, "elbow", 10000, fcl::Vec3f(0,0,0), 0.1);
+    const std::string textFile(temporaryFile("test-sampling-db-text")), binaryFile(temporaryFile("test-sampling-db-binary"));
+    {
+        std::ofstream text(textFile.c_str());
+        saveLimbDatabase(sc, text);
+        std::ofstream binary(binaryFile.c_str(), std::ios::out | std::ios::binary);
+        BOOST_CHECK_MESSAGE (saveLimbDatabaseBinary(sc, binary), "binary database could not be written");
+    }
+    double start = omp_get_wtime();
+    std::ifstream text(textFile.c_str());
+    SampleDB fromText(text);
+    const double textTime = wallElapsedMs(start);
+    start = omp_get_wtime();
+    SampleDB fromBinary(binaryFile, 0);
+    const double binaryTime = wallElapsedMs(start);
+    std::remove(textFile.c_str());
+    std::remove(binaryFile.c_str());
+    BOOST_TEST_MESSAGE ("loading 10000 samples: text " << textTime << " ms, binary " << binaryTime << " ms");
+
+    BOOST_CHECK_MESSAGE (fromBinary.samples_.size() == sc.samples_.size(), "binary database should contain all samples");
+    BOOST_CHECK_MESSAGE (fromBinary.samplesInVoxels_.size() == fromText.samplesInVoxels_.size(), "voxel indexes should match");
+    BOOST_CHECK_MESSAGE (fromBinary.boxes_.size() == sc.boxes_.size(), "voxel boxes should be loaded with the database");
+    BOOST_CHECK_MESSAGE (fromBinary.octomapTree_->size() == sc.octomapTree_->size(), "octree should be loaded with the database");
+    for(std::size_t i = 0; i < sc.samples_.size(); ++i)
+    {
+        const Sample& s = sc.samples_[i], & b = fromBinary.samples_[i];
+        BOOST_CHECK_MESSAGE (s.id_ == b.id_ && s.effectorPosition_ == b.effectorPosition_
+                             && s.configuration_ == b.configuration_ && s.jacobian_ == b.jacobian_,
+                             "binary sample differs from original");
+    }
+    // the loaded octree and voxel index must answer requests as the original ones
+    CollisionObjectPtr_t obstacle = MeshObstacleBox();
+    const T_OctreeReport original = GetCandidates(sc, fcl::Transform3f(), obstacle, fcl::Vec3f(1,0,0));
+    const T_OctreeReport loaded = GetCandidates(fromBinary, fcl::Transform3f(), obstacle, fcl::Vec3f(1,0,0));
+    BOOST_CHECK_MESSAGE (!original.empty(), "No matching found, this should not be the case");
+    BOOST_REQUIRE_EQUAL(original.size(), loaded.size());
+    std::vector<std::size_t> originalIds, loadedIds;
+    for(T_OctreeReport::const_iterator cit = original.begin(); cit != original.end(); ++cit)
+        originalIds.push_back(cit->sample_->id_);
+    for(T_OctreeReport::const_iterator cit = loaded.begin(); cit != loaded.end(); ++cit)
+        loadedIds.push_back(cit->sample_->id_);
+    std::sort(originalIds.begin(), originalIds.end());
+    std::sort(loadedIds.begin(), loadedIds.end());
+    BOOST_CHECK_MESSAGE (originalIds == loadedIds, "loaded database should return the same candidates");
+}
 }
 
 BOOST_AUTO_TEST_SUITE_END()
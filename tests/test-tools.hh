@@ -167,6 +167,31 @@ namespace
     }
 
 
+    /// Flat terrain of size x size meters, centered on the origin at height z,
+    /// made of 2 * nbCells * nbCells triangles
+    CollisionObjectPtr_t MeshTerrain(const double size, const std::size_t nbCells, const double z = 0)
+    {
+        BVHModel<fcl::OBBRSS>* m1 = new BVHModel<fcl::OBBRSS>;
+        std::vector<fcl::Vec3f> p1;
+        std::vector<fcl::Triangle> t1;
+        const double step = size / (double)nbCells;
+        for(std::size_t i = 0; i <= nbCells; ++i)
+            for(std::size_t j = 0; j <= nbCells; ++j)
+                p1.push_back(fcl::Vec3f(-size / 2 + (double)i * step, -size / 2 + (double)j * step, z));
+        for(std::size_t i = 0; i < nbCells; ++i)
+            for(std::size_t j = 0; j < nbCells; ++j)
+            {
+                std::size_t v = i * (nbCells + 1) + j;
+                t1.push_back(fcl::Triangle(v, v + nbCells + 1, v + 1));
+                t1.push_back(fcl::Triangle(v + 1, v + nbCells + 1, v + nbCells + 2));
+            }
+        m1->beginModel();
+        m1->addSubModel(p1, t1);
+        m1->endModel();
+        CollisionGeometryPtr_t colGeom (m1);
+        return CollisionObject::create(colGeom, fcl::Transform3f (), "terrain");
+    }
+
     DevicePtr_t initDevice()
     {
         DevicePtr_t rom = Device::create("rom");